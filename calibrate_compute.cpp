@@ -0,0 +1,160 @@
+// calibrate_compute.cpp
+// Measures run-sort and merge throughput on this machine and writes a fitted
+// compute profile that external_sort_sim loads in place of compute_speed_MBps.
+//
+// Build: g++ -O2 -std=c++17 -pthread calibrate_compute.cpp radix_sort.cpp kway_merge.cpp run_codec.cpp -o calibrate_compute
+// Usage: ./calibrate_compute [profile_path=compute_profile.txt] [max_threads=hw] [max_size_MB=256]
+//
+// For every thread count and input size the sort kernel (radix_sort_multi_threaded,
+// which falls back to radix_sort_single_lsb at one thread) and the merge kernel
+// (kway_merge, one independent merge per thread) are timed, then a line
+//     time_sec = fixed_sec + size_MB / MBps
+// is fitted by least squares per (kernel, threads). The run codec (run_codec.cpp)
+// is timed single-threaded on sorted runs and reported with its measured ratio.
+
+#include "radix_sort.hpp"
+#include "kway_merge.hpp"
+#include "run_codec.hpp"
+#include "util.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+static const int MERGE_FANIN = 16;  // fan-in used when timing the merge kernel
+static const int REPEATS = 3;       // best-of-N timing per point
+
+struct Sample { double size_MB, time_sec; };
+struct Fit { double fixed_sec, MBps; };
+
+// Least-squares fit of time = a + b*size, reported as {a, 1/b}
+static Fit fit_line(const vector<Sample>& pts) {
+    double n = pts.size(), sx = 0, sy = 0, sxx = 0, sxy = 0;
+    for (auto& p : pts) { sx += p.size_MB; sy += p.time_sec; sxx += p.size_MB * p.size_MB; sxy += p.size_MB * p.time_sec; }
+    double den = n * sxx - sx * sx;
+    double b = den > 0 ? (n * sxy - sx * sy) / den : 0;
+    double a = (sy - b * sx) / n;
+    if (b <= 0) { // degenerate (single point or noise): pure throughput through the largest sample
+        auto& big = *max_element(pts.begin(), pts.end(), [](const Sample& l, const Sample& r){ return l.size_MB < r.size_MB; });
+        return {0.0, big.size_MB / big.time_sec};
+    }
+    return {a, 1.0 / b};  // a may be slightly negative; ComputeProfile clamps it when applying the fit
+}
+
+static double time_sort(const vector<uint64_t>& keys, size_t threads) {
+    vector<uint64_t> in(keys.size()), out(keys.size());
+    double best = 1e30;
+    for (int r = 0; r < REPEATS; ++r) {
+        copy(keys.begin(), keys.end(), in.begin());
+        double t0 = now_sec();
+        radix_sort_multi_threaded(in.data(), out.data(), in.size(), threads);
+        best = min(best, now_sec() - t0);
+    }
+    if (!is_sorted(out.begin(), out.end())) { cerr << "sort kernel produced unsorted output\n"; exit(1); }
+    return best;
+}
+
+// keys is split into `threads` partitions, each cut into MERGE_FANIN sorted runs
+static double time_merge(const vector<uint64_t>& keys, size_t threads) {
+    vector<uint64_t> runs = keys, out(keys.size());
+    size_t N = keys.size();
+    vector<vector<pair<const uint64_t*, size_t>>> parts(threads);
+    for (size_t t = 0; t < threads; ++t) {
+        size_t pb = N * t / threads, pe = N * (t + 1) / threads;
+        for (int k = 0; k < MERGE_FANIN; ++k) {
+            size_t rb = pb + (pe - pb) * k / MERGE_FANIN, re = pb + (pe - pb) * (k + 1) / MERGE_FANIN;
+            sort(runs.begin() + rb, runs.begin() + re);
+            parts[t].push_back({runs.data() + rb, re - rb});
+        }
+    }
+    double best = 1e30;
+    for (int r = 0; r < REPEATS; ++r) {
+        double t0 = now_sec();
+        parallel(threads, [&](size_t t) { kway_merge(parts[t], out.data() + N * t / threads); });
+        best = min(best, now_sec() - t0);
+    }
+    return best;
+}
+
+// Encodes and decodes one sorted run: returns the decode sample, sets encode time and ratio
+static Sample time_codec(const vector<uint64_t>& keys, double& enc_sec, double& ratio) {
+    vector<uint64_t> run = keys, back(keys.size());
+    sort(run.begin(), run.end());
+    vector<uint8_t> enc;
+    double best_enc = 1e30, best_dec = 1e30;
+    for (int r = 0; r < REPEATS; ++r) {
+        enc.clear();
+        double t0 = now_sec();
+        encode_sorted_run(run.data(), run.size(), enc);
+        best_enc = min(best_enc, now_sec() - t0);
+        t0 = now_sec();
+        decode_sorted_run(enc.data(), enc.size(), back.data());
+        best_dec = min(best_dec, now_sec() - t0);
+    }
+    if (back != run) { cerr << "run codec round trip failed\n"; exit(1); }
+    enc_sec = best_enc;
+    ratio = double(run.size() * sizeof(uint64_t)) / enc.size();
+    return {keys.size() * sizeof(uint64_t) / 1048576.0, best_dec};
+}
+
+int main(int argc, char** argv) {
+    string path = argc > 1 ? argv[1] : "compute_profile.txt";
+    size_t max_threads = max(1, argc > 2 ? atoi(argv[2]) : int(thread::hardware_concurrency()));
+    double max_MB = argc > 3 ? atof(argv[3]) : 256;
+
+    vector<size_t> thread_counts;
+    for (size_t t = 1; t < max_threads; t *= 2) thread_counts.push_back(t);
+    thread_counts.push_back(max_threads);
+    vector<double> sizes;
+    for (double mb = 1; mb <= max_MB; mb *= 4) sizes.push_back(mb);
+
+    mt19937_64 gen(42);
+    ofstream f(path);
+    if (!f) { cerr << "cannot write " << path << "\n"; return 1; }
+    f << "# compute profile written by calibrate_compute\n";
+    f << "# sort  <threads> <fixed_sec> <MBps>\n";
+    f << "# merge <threads> <fixed_sec> <MBps> <fanin>\n";
+    f << "# codec <name> <ratio> <compress_MBps> <decompress_MBps>  (single thread, uncompressed MB)\n";
+
+    for (size_t th : thread_counts) {
+        vector<Sample> sort_pts, merge_pts;
+        for (double mb : sizes) {
+            vector<uint64_t> keys(size_t(mb * 1024 * 1024 / sizeof(uint64_t)));
+            for (auto& k : keys) k = gen();
+            double ts = time_sort(keys, th), tm = time_merge(keys, th);
+            sort_pts.push_back({mb, ts});
+            merge_pts.push_back({mb, tm});
+            cout << "threads=" << th << " size=" << mb << "MB"
+                 << "  sort " << mb / ts << " MB/s"
+                 << "  merge(k=" << MERGE_FANIN << ") " << mb / tm << " MB/s\n";
+        }
+        Fit s = fit_line(sort_pts), m = fit_line(merge_pts);
+        f << "sort " << th << " " << s.fixed_sec << " " << s.MBps << "\n";
+        f << "merge " << th << " " << m.fixed_sec << " " << m.MBps << " " << MERGE_FANIN << "\n";
+    }
+    vector<Sample> enc_pts, dec_pts;
+    double ratio_sum = 0;
+    for (double mb : sizes) {
+        vector<uint64_t> keys(size_t(mb * 1024 * 1024 / sizeof(uint64_t)));
+        for (auto& k : keys) k = gen();
+        double enc_sec, ratio;
+        Sample dec = time_codec(keys, enc_sec, ratio);
+        enc_pts.push_back({mb, enc_sec});
+        dec_pts.push_back(dec);
+        ratio_sum += ratio;
+        cout << "codec delta-varint size=" << mb << "MB  ratio " << ratio
+             << "  compress " << mb / enc_sec << " MB/s  decompress " << mb / dec.time_sec << " MB/s\n";
+    }
+    f << "codec delta-varint " << ratio_sum / sizes.size() << " " << fit_line(enc_pts).MBps
+      << " " << fit_line(dec_pts).MBps << "\n";
+
+    cout << "Profile written to " << path << "\n";
+    return 0;
+}
@@ -0,0 +1,112 @@
+#include "co_sort.hpp"
+#include "kway_merge.hpp"
+#include "radix_sort.hpp"
+#include "util.hpp"
+#include <algorithm>
+#include <exception>
+#include <thread>
+#include <vector>
+
+static const unsigned TOP_BITS = 16;     // MSD pre-partition granularity
+static const double MIN_SHARE = 0.01;    // both sides keep enough work to be measured
+
+CoSorter::CoSorter(const CoSortConfig& cfg)
+    : cfg_(cfg), device_(cfg.device),
+      share_(std::clamp(cfg.device_share, MIN_SHARE, 1 - MIN_SHARE)) {
+    size_t hw = std::max(2u, std::thread::hardware_concurrency());
+    threads_ = cfg_.cpu_threads ? cfg_.cpu_threads : hw - 1;
+}
+
+// Picks the top-TOP_BITS bucket boundary closest to `want` keys below it. If
+// that misses by at most a quarter of the smaller side, writes in[0..n) to out with the keys below the
+// boundary first, sets m to their count and returns true. Runs on all
+// threads, as the device is idle.
+bool CoSorter::partition(const uint64_t* in, uint64_t* out, size_t n, size_t want, size_t& m) {
+    const size_t BUCKETS = size_t(1) << TOP_BITS;
+    const unsigned SHIFT = 64 - TOP_BITS;
+    const size_t threads = threads_ + 1;
+    std::vector<std::vector<size_t>> hist(threads, std::vector<size_t>(BUCKETS));
+    std::vector<size_t> begin(threads + 1);
+    for (size_t t = 0; t <= threads; ++t) begin[t] = n * t / threads;
+
+    parallel(threads, [&](size_t t) {
+        for (size_t i = begin[t]; i < begin[t + 1]; ++i) ++hist[t][in[i] >> SHIFT];
+    });
+    size_t pivot = 0, below = 0, best = want;  // best: |below - want| at pivot
+    for (size_t b = 0, sum = 0; b <= BUCKETS; ++b) {
+        size_t dist = sum > want ? sum - want : want - sum;
+        if (dist < best) { best = dist; pivot = b; below = sum; }
+        if (b < BUCKETS) for (size_t t = 0; t < threads; ++t) sum += hist[t][b];
+    }
+    if (best > std::min(want, n - want) / 4) return false;
+
+    std::vector<size_t> lo(threads), hi(threads);
+    for (size_t t = 0, lo_sum = 0, hi_sum = below; t < threads; ++t) {
+        size_t low = 0;
+        for (size_t b = 0; b < pivot; ++b) low += hist[t][b];
+        lo[t] = lo_sum;
+        hi[t] = hi_sum;
+        lo_sum += low;
+        hi_sum += begin[t + 1] - begin[t] - low;
+    }
+    parallel(threads, [&](size_t t) {
+        for (size_t i = begin[t]; i < begin[t + 1]; ++i) {
+            if ((in[i] >> SHIFT) < pivot) out[lo[t]++] = in[i];
+            else out[hi[t]++] = in[i];
+        }
+    });
+    m = below;
+    return true;
+}
+
+void CoSorter::sort(uint64_t* data, size_t n) {
+    last_ = CoSortStats();
+    if (n == 0) return;
+    if (scratch_.size() < n) scratch_.resize(n);
+    uint64_t* scratch = scratch_.data();
+
+    // Device gets the low part. With a usable MSD split the parts go to
+    // scratch and sort back into data; otherwise they sort from data into
+    // scratch and are merged back.
+    double t0 = now_sec();
+    size_t want = std::min(n, size_t(share_ * n + 0.5)), m = want;
+    uint64_t* src = scratch;
+    uint64_t* dst = data;
+    if (!partition(data, scratch, n, want, m)) {
+        last_.merged = true;
+        src = data;
+        dst = scratch;
+    }
+    last_.partition_sec = now_sec() - t0;
+
+    std::exception_ptr device_error;
+    std::thread device_side([&] {
+        double t = now_sec();
+        try {
+            if (m > 0) device_.sort_chunked(src, dst, m);
+        } catch (...) {
+            device_error = std::current_exception();
+        }
+        last_.device_sec = now_sec() - t;
+    });
+    double t = now_sec();
+    if (m < n) radix_sort_multi_threaded(src + m, dst + m, n - m, threads_);
+    last_.cpu_sec = now_sec() - t;
+    device_side.join();
+    if (device_error) std::rethrow_exception(device_error);
+
+    if (last_.merged) {
+        t = now_sec();
+        kway_merge<uint64_t>({{scratch, m}, {scratch + m, n - m}}, data);
+        last_.partition_sec += now_sec() - t;
+    }
+    last_.device_keys = m;
+    last_.cpu_keys = n - m;
+
+    // Next split: each side's share of the combined keys-per-second
+    if (m > 0 && m < n && last_.device_sec > 0 && last_.cpu_sec > 0) {
+        double device_rate = m / last_.device_sec, cpu_rate = (n - m) / last_.cpu_sec;
+        double target = device_rate / (device_rate + cpu_rate);
+        share_ = std::clamp((1 - cfg_.smoothing) * share_ + cfg_.smoothing * target, MIN_SHARE, 1 - MIN_SHARE);
+    }
+}
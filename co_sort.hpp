@@ -0,0 +1,50 @@
+#pragma once
+#include "opencl_sort.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Heterogeneous sort: an OpenCL device and the host's cores
+// (radix_sort_multi_threaded) each sort part of the input at the same time.
+// The input is MSD pre-partitioned on its top 16 bits so the device gets the
+// smallest keys and the CPU the rest, and the two sorted parts simply
+// concatenate. When the keys are too skewed for a bucket boundary to land
+// near the wanted split, it falls back to splitting by position and merging.
+// The device's share follows the measured throughput of both sides.
+
+struct CoSortConfig {
+    OpenCLSortConfig device;
+    size_t cpu_threads = 0;                  // 0: hardware threads minus the one driving the device
+    double device_share = 0.5;               // fraction of keys for the device in the first call
+    double smoothing = 0.5;                  // weight of the latest call when updating the share
+};
+
+// What the last call did
+struct CoSortStats {
+    size_t device_keys = 0, cpu_keys = 0;
+    double device_sec = 0, cpu_sec = 0;      // wall time of each side, running concurrently
+    double partition_sec = 0;                // top-bits histogram and split (or the merge)
+    bool merged = false;                     // skew forced a position split and merge
+};
+
+class CoSorter {
+public:
+    explicit CoSorter(const CoSortConfig& cfg = CoSortConfig());
+
+    // Sorts data[0..n) in place
+    void sort(uint64_t* data, size_t n);
+
+    double device_share() const { return share_; }  // used by the next call
+    const CoSortStats& last() const { return last_; }
+    OpenCLSorter& device() { return device_; }
+
+private:
+    bool partition(const uint64_t* in, uint64_t* out, size_t n, size_t want, size_t& m);
+
+    CoSortConfig cfg_;
+    OpenCLSorter device_;
+    size_t threads_;
+    double share_;
+    CoSortStats last_;
+    std::vector<uint64_t> scratch_;
+};
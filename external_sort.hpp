@@ -0,0 +1,43 @@
+#pragma once
+#include "local_object_store.hpp"
+#include <string>
+#include <vector>
+
+// Real external sort of uint64_t keys stored in a LocalObjectStore.
+// Phase 1 reads the input in run_MB slices, sorts each slice in memory with
+// radix_sort_multi_threaded and writes it back as a run object. Phase 2 runs
+// balanced fanin-way merge passes, streaming every input run through a
+// buffer_MB ranged-GET buffer and uploading the output in buffer_MB parts,
+// until a single run (the output object) is left.
+
+struct ExternalSortConfig {
+    double run_MB = 512;     // in-memory run size
+    int fanin = 4;           // merge fan-in per pass
+    double buffer_MB = 64;   // read buffer per input run and output part size
+    size_t threads = 1;      // threads used for run sorting
+    std::string prefix = "tmp/"; // key prefix for intermediate runs
+};
+
+// Measurements for one phase of the sort
+struct PhaseStats {
+    std::string name;        // "run_generation", "merge_pass_1", ...
+    double wall_sec = 0;     // elapsed time including store delays
+    double compute_sec = 0;  // time spent sorting or merging in memory
+    int runs_in = 0;
+    int runs_out = 0;
+    StoreStats store;        // requests, bytes and cost issued in this phase
+};
+
+class ExternalSortEngine {
+public:
+    ExternalSortEngine(LocalObjectStore& store, const ExternalSortConfig& cfg);
+    // Sort input_key into output_key; returns per-phase measurements
+    std::vector<PhaseStats> sort(const std::string& input_key, const std::string& output_key);
+
+private:
+    std::vector<std::string> generate_runs(const std::string& input_key, PhaseStats& ps);
+    void merge_runs(const std::vector<std::string>& in, const std::string& out, PhaseStats& ps);
+
+    LocalObjectStore& store_;
+    ExternalSortConfig cfg_;
+};
@@ -2,175 +2,23 @@
 // A modular external sorting simulator prototype for cloud-like settings
 // Simulates I/O, network variability, data skew, chunked access patterns, and compute for various external sorting algorithms
 
+#include "external_sort_sim.hpp"
 #include <iostream>
-#include <vector>
-#include <string>
-#include <cmath>
-#include <random>
-#include <numeric>
 
 using namespace std;
 
-// Random engine for variability
-typedef std::mt19937_64 RNG;
-static RNG rng(42);
-
-// Simulated object store with latency, throughput, variability, and cost characteristics
-struct ObjectStore {
-    double latency_ms;         // base latency per operation
-    double mean_throughput_MBps;    // nominal throughput per stream
-    double throughput_jitter;  // fractional jitter (e.g., 0.2 means ±20%)
-    double cost_per_GB;        // cost per GB transferred
-    double cost_per_request;   // fixed cost per API call
-    double chunk_size_MB;      // chunk size for I/O granularity
-
-    // Sample a throughput for this operation
-    double sample_throughput() {
-        normal_distribution<double> d(mean_throughput_MBps, mean_throughput_MBps * throughput_jitter);
-        return max(1.0, d(rng));
-    }
-
-    // Simulate read: compute time and cost, but do not sleep
-    pair<double,double> read(double size_MB) {
-        int num_chunks = ceil(size_MB / chunk_size_MB);
-        double total_time = 0.0, total_cost = 0.0;
-        double remaining = size_MB;
-        for (int i = 0; i < num_chunks; ++i) {
-            double this_chunk = min(chunk_size_MB, remaining);
-            remaining -= this_chunk;
-            double thr = sample_throughput();
-            double t = latency_ms/1000.0 + this_chunk/thr;
-            double c = this_chunk * cost_per_GB / 1024.0 + cost_per_request;
-            total_time += t;
-            total_cost += c;
-        }
-        return {total_time, total_cost};
-    }
-
-    // Simulate write: compute time and cost, but do not sleep
-    pair<double,double> write(double size_MB) {
-        int num_chunks = ceil(size_MB / chunk_size_MB);
-        double total_time = 0.0, total_cost = 0.0;
-        double remaining = size_MB;
-        for (int i = 0; i < num_chunks; ++i) {
-            double this_chunk = min(chunk_size_MB, remaining);
-            remaining -= this_chunk;
-            double thr = sample_throughput();
-            double t = latency_ms/1000.0 + this_chunk/thr;
-            double c = this_chunk * cost_per_GB / 1024.0 + cost_per_request;
-            total_time += t;
-            total_cost += c;
-        }
-        return {total_time, total_cost};
-    }
-};
-
-// Simulated compute node or function with slowdown probability
-struct ComputeNode {
-    double compute_speed_MBps; // how fast it can sort
-    double cost_per_hour;      // compute cost per hour
-    double straggler_prob;     // probability a task is slowed
-    double straggler_factor;   // slowdown multiplier if straggler
-
-    // Simulate sort: compute time and cost, no sleep
-    pair<double,double> sort(double size_MB) {
-        bool is_straggler = (uniform_real_distribution<double>(0,1)(rng) < straggler_prob);
-        double speed = compute_speed_MBps * (is_straggler ? (1.0/straggler_factor) : 1.0);
-        double time_sec = size_MB / speed;
-        double cost = time_sec * (cost_per_hour / 3600.0);
-        return {time_sec, cost};
-    }
-};
-
-// Generate run sizes based on data skew distribution
-vector<double> generate_run_sizes(double dataset_MB, double avg_run_MB, double skew_alpha) {
-    int num_runs = ceil(dataset_MB / avg_run_MB);
-    vector<double> weights(num_runs);
-    for (int i = 1; i <= num_runs; ++i) weights[i-1] = 1.0 / pow(i, skew_alpha);
-    double sum_w = accumulate(weights.begin(), weights.end(), 0.0);
-    for (auto &w : weights) w /= sum_w;
-    vector<double> sizes(num_runs);
-    for (int i = 0; i < num_runs; ++i) sizes[i] = weights[i] * dataset_MB;
-    return sizes;
-}
-
-// Base class for external sort algorithms
-class ExternalSortAlgo {
-public:
-    virtual string name() = 0;
-    // Run simulation on dataset_MB; returns time (sec) and cost ($)
-    virtual pair<double,double> run(double dataset_MB, ObjectStore& store, ComputeNode& node) = 0;
-    virtual ~ExternalSortAlgo() = default;
-};
-
-// 1) Two-Phase Merge Sort (non-skewed)
-class TwoPhaseNoSkew : public ExternalSortAlgo {
-public:
-    string name() override { return "Two-Phase Merge Sort (no skew)"; }
-    pair<double,double> run(double dataset_MB, ObjectStore& store, ComputeNode& node) override {
-        double chunk = 512;
-        int runs = ceil(dataset_MB / chunk);
-        double t=0,c=0;
-        // initial runs
-        for(int i=0;i<runs;++i){ auto rd=store.read(chunk); t+=rd.first; c+=rd.second; auto st=node.sort(chunk); t+=st.first; c+=st.second; auto wt=store.write(chunk); t+=wt.first; c+=wt.second; }
-        // merge all
-        auto rd_all=store.read(dataset_MB); t+=rd_all.first; c+=rd_all.second;
-        auto st_all=node.sort(dataset_MB); t+=st_all.first; c+=st_all.second;
-        auto wt_all=store.write(dataset_MB); t+=wt_all.first; c+=wt_all.second;
-        return {t,c};
-    }
-};
-
-// 2) Two-Phase Merge Sort (skewed)
-class TwoPhaseSkew : public ExternalSortAlgo {
-public:
-    string name() override { return "Two-Phase Merge Sort (skewed)"; }
-    pair<double,double> run(double dataset_MB, ObjectStore& store, ComputeNode& node) override {
-        auto runs = generate_run_sizes(dataset_MB, 512, 1.1);
-        double t=0,c=0;
-        for(auto sz: runs){ auto rd=store.read(sz); t+=rd.first; c+=rd.second; auto st=node.sort(sz); t+=st.first; c+=st.second; auto wt=store.write(sz); t+=wt.first; c+=wt.second; }
-        auto rd_all=store.read(dataset_MB); t+=rd_all.first; c+=rd_all.second;
-        auto st_all=node.sort(dataset_MB); t+=st_all.first; c+=st_all.second;
-        auto wt_all=store.write(dataset_MB); t+=wt_all.first; c+=wt_all.second;
-        return {t,c};
-    }
-};
-
-// 3) K-Way Merge Sort (non-skewed)
-class KWayNoSkew : public ExternalSortAlgo {
-    int k;
-public:
-    KWayNoSkew(int k_):k(k_){}
-    string name() override { return string("K-Way Merge Sort (no skew, k=")+to_string(k)+")"; }
-    pair<double,double> run(double dataset_MB, ObjectStore& store, ComputeNode& node) override {
-        double chunk=512; int runs=ceil(dataset_MB/chunk);
-        int passes=ceil(log(runs)/log(k)); double t=0,c=0;
-        for(int i=0;i<runs;++i){ auto rd=store.read(chunk); t+=rd.first; c+=rd.second; auto st=node.sort(chunk); t+=st.first; c+=st.second; auto wt=store.write(chunk); t+=wt.first; c+=wt.second; }
-        for(int p=0;p<passes;++p){ auto rd=store.read(dataset_MB); t+=rd.first; c+=rd.second; auto st=node.sort(dataset_MB); t+=st.first; c+=st.second; auto wt=store.write(dataset_MB); t+=wt.first; c+=wt.second; }
-        return {t,c};
-    }
-};
-
-// 4) K-Way Merge Sort (skewed)
-class KWaySkew : public ExternalSortAlgo {
-    int k;
-public:
-    KWaySkew(int k_):k(k_){}
-    string name() override { return string("K-Way Merge Sort (skewed, k=")+to_string(k)+")"; }
-    pair<double,double> run(double dataset_MB, ObjectStore& store, ComputeNode& node) override {
-        auto runs=generate_run_sizes(dataset_MB,512,1.1);
-        int passes=ceil(log(runs.size())/log(k)); double t=0,c=0;
-        for(auto sz:runs){ auto rd=store.read(sz); t+=rd.first; c+=rd.second; auto st=node.sort(sz); t+=st.first; c+=st.second; auto wt=store.write(sz); t+=wt.first; c+=wt.second; }
-        for(int p=0;p<passes;++p){ auto rd=store.read(dataset_MB); t+=rd.first; c+=rd.second; auto st=node.sort(dataset_MB); t+=st.first; c+=st.second; auto wt=store.write(dataset_MB); t+=wt.first; c+=wt.second; }
-        return {t,c};
-    }
-};
-
-int main(){
+int main(int argc, char** argv){
     double dataset_MB=10*1024; //10GB
     ObjectStore s3{50,100,0.2,0.023,0.000005,64};
     ComputeNode lambda{100,6,0.1,4};
 
+    // optional calibrated compute profile (see calibrate_compute.cpp)
+    ComputeProfile profile;
+    if(argc>1){
+        if(!profile.load(argv[1])){ cerr<<"Cannot load compute profile "<<argv[1]<<"\n"; return 1; }
+        lambda.profile=&profile;
+    }
+
     vector<ExternalSortAlgo*> algos{
         new TwoPhaseNoSkew(), new TwoPhaseSkew(),
         new KWayNoSkew(4), new KWaySkew(4)
@@ -184,5 +32,128 @@ int main(){
         cout<<"-----------------------------\n";
     }
     for(auto* a: algos) delete a;
+
+    // Comparisons below average sim_trials runs of each configuration
+    const int sim_trials=1000;
+
+    // Storage hierarchy: where runs and merge-pass outputs live
+    FastTier cache{"in-memory cache",8*1024,0.5,1000,0.016,0,4};
+    FastTier volume{"ephemeral volume",16*1024,1,250,0.00011,0,4};
+    cout<<"Fast-tier placement ("<<dataset_MB/1024<<" GB, mean of "<<sim_trials<<" runs)\n";
+    for(auto* tier: {&cache,&volume}){
+        for(auto pl: {Placement::ObjectStoreOnly,Placement::AllFast,Placement::SpillOnOverflow,Placement::MergePassOnly}){
+            TieredKWay a(4,*tier,pl);
+            auto r=mean_run(a,dataset_MB,s3,lambda,sim_trials);
+            cout<<"  "<<a.name()<<": ";
+            if(isinf(r.first)) cout<<"infeasible (capacity "<<tier->capacity_MB/1024<<" GB)\n";
+            else cout<<r.first<<" s, $"<<r.second<<"\n";
+        }
+    }
+    cout<<"-----------------------------\n";
+
+    // Compression: per-codec simulated time/cost and analytic break-even
+    vector<Codec> codecs=default_codecs();
+    codecs.insert(codecs.end(),profile.codecs.begin(),profile.codecs.end());
+    KWayNoSkew plain(4);
+    auto base=mean_run(plain,dataset_MB,s3,lambda,sim_trials);
+    cout<<"Compression ("<<plain.name()<<" uncompressed: "<<base.first<<" s, $"<<base.second
+        <<"; mean of "<<sim_trials<<" runs)\n";
+    for(auto& cd: codecs){
+        CompressedKWay a(4,cd,true,true);
+        auto r=mean_run(a,dataset_MB,s3,lambda,sim_trials);
+        auto be=codec_break_even(cd,s3,lambda);
+        cout<<"  "<<a.name()<<": "<<r.first<<" s, $"<<r.second
+            <<"; pays off in time below "<<be.store_MBps<<" MB/s store throughput"
+            <<", saves "<<be.time_saved_sec*1024<<" s and $"<<be.cost_saved*1024<<" per GB\n";
+    }
+    cout<<"-----------------------------\n";
+
+    // Merge schedules: bytes actually moved by the merge phase
+    cout<<"Merge schedules ("<<dataset_MB/1024<<" GB)\n";
+    for(bool skewed: {false,true}){
+        for(auto sch: {MergeScheme::Balanced,MergeScheme::PartialFirstPass,MergeScheme::Polyphase,MergeScheme::Cascade}){
+            ScheduledMergeSort a(4,sch,skewed);
+            auto r=a.run(dataset_MB,s3,lambda);
+            double merge_MB=0; for(auto& p: a.phases) if(p.name!="run_generation") merge_MB+=p.MB_read;
+            cout<<"  "<<a.name()<<": "<<r.first<<" s, $"<<r.second<<", "<<a.phases.size()-1
+                <<" merge passes, "<<merge_MB/1024<<" GB merged\n";
+        }
+    }
+    cout<<"-----------------------------\n";
+
+    // Heterogeneous cluster: cheapest instance mix, single pool vs mixed pools
+    vector<InstancePool> pools{
+        {"compute-opt", ComputeNode{300,0.68,0.05,3}, 1200, 8*1024, 32},
+        {"network-opt", ComputeNode{150,0.85,0.05,3}, 3000, 16*1024, 16},
+        {"general", ComputeNode{120,0.38,0.05,3}, 600, 16*1024, 64},
+    };
+    double deadline=300;
+    cout<<"Instance mix ("<<dataset_MB/1024<<" GB, deadline "<<deadline<<" s on the mean of 20 runs)\n";
+    for(bool single: {true,false}){
+        auto best=cheapest_cluster_plan(pools,dataset_MB,s3,4,deadline,single);
+        cout<<"  cheapest "<<(single?"single-pool":"mixed")<<": ";
+        if(isinf(best.second.second)){ cout<<"none meets the deadline\n"; continue; }
+        cout<<ClusterKWay(pools,best.first,4).name()<<": "<<best.second.first<<" s, $"<<best.second.second<<"\n";
+    }
+    cout<<"-----------------------------\n";
+
+    // Multi-tenant contention: makespan vs background intensity. Every point
+    // replays the same random draws, so the curves differ only by the load.
+    cout<<"Contention sensitivity ("<<dataset_MB/1024<<" GB, mean of "<<sim_trials<<" runs)\n";
+    ObjectStore shared=s3;
+    shared.max_requests_per_sec=3500;
+    const char* pname[]={"constant","diurnal","bursty"};
+    const RNG draws=rng;
+    for(auto pat: {BackgroundLoad::Constant,BackgroundLoad::Diurnal,BackgroundLoad::Bursty}){
+        cout<<"  "<<pname[pat]<<":";
+        for(double share: {0.0,0.25,0.5,0.75}){
+            BackgroundLoad bg{pat,share,3500*share,share,0.5,4*3600,60,0.2};
+            ObjectStore st=shared; ComputeNode nd=lambda;
+            st.background=&bg; nd.background=&bg;
+            KWayNoSkew a(4);
+            rng=draws;
+            double single=mean_run(a,dataset_MB,st,nd,sim_trials).first;
+            bg.now=0;
+            ClusterKWay cl(pools,ClusterPlan{0,16,1,16},4);
+            rng=draws;
+            double cluster=mean_run(cl,dataset_MB,st,nd,sim_trials).first;
+            cout<<"  load "<<share<<": "<<single<<" s / cluster "<<cluster<<" s;";
+        }
+        cout<<"\n";
+    }
+    cout<<"-----------------------------\n";
+
+    // Shuffle: pull-based M x R vs push-based merge-on-receive
+    cout<<"Shuffle ("<<dataset_MB/1024<<" GB, mean of "<<sim_trials<<" runs)\n";
+    {
+        PullShuffleSort pull(16,16);
+        auto r=mean_run(pull,dataset_MB,s3,lambda,sim_trials);
+        cout<<"  "<<pull.name()<<": "<<r.first<<" s, $"<<r.second<<", "<<pull.reducer_memory_MB(s3)<<" MB per reducer\n";
+        for(double buf: {128.0,512.0,2048.0}){
+            PushShuffleSort push(16,16,1200,buf);
+            r=mean_run(push,dataset_MB,s3,lambda,sim_trials);
+            cout<<"  "<<push.name()<<": "<<r.first<<" s, $"<<r.second<<", "<<push.reducer_memory_MB(dataset_MB)<<" MB per reducer\n";
+        }
+    }
+    cout<<"-----------------------------\n";
+
+    // Spot vs on-demand: replay the fault-free K-way breakdown under interruptions
+    const int trials=200;
+    KWayNoSkew kway(4);
+    SpotModel restart{0.2,120,90,0.3,false,1024}, resume=restart;
+    resume.merge_checkpoints=true;
+    cout<<"Spot vs on-demand ("<<kway.name()<<", "<<trials<<" trials)\n";
+    for(double size_MB: {10.0*1024, 100.0*1024, 1024.0*1024}){
+        auto od=kway.run(size_MB,s3,lambda);
+        cout<<"  "<<size_MB/1024<<" GB on-demand: "<<od.first<<" s, $"<<od.second<<"\n";
+        for(auto* spot: {&restart,&resume}){
+            vector<double> times; double cost=0;
+            for(int i=0;i<trials;++i){ auto r=spot->replay(kway.phases,lambda); times.push_back(r.first); cost+=r.second/trials; }
+            sort(times.begin(),times.end());
+            double mean=accumulate(times.begin(),times.end(),0.0)/trials;
+            cout<<"    spot, merges "<<(spot->merge_checkpoints?"resume":"restart")<<": mean "<<mean<<" s, p95 "
+                <<times[trials*95/100]<<" s, $"<<cost<<(cost<od.second?" (cheaper)":" (not cheaper)")<<"\n";
+        }
+    }
     return 0;
 }
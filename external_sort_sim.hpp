@@ -0,0 +1,1063 @@
+#pragma once
+// external_sort_sim.hpp
+// Cost/time model of the simulator: object store, compute node and the
+// external sort algorithms. Shared by external_sort_sim and the validation tools.
+
+#include <vector>
+#include <string>
+#include <cmath>
+#include <random>
+#include <numeric>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <utility>
+#include <deque>
+#include <queue>
+
+// Random engine for variability
+typedef std::mt19937_64 RNG;
+inline RNG rng(42);
+
+// Load from other tenants sharing the bucket and the network. All effects
+// scale with intensity(now): the background job takes bw_share of the store's
+// per-stream throughput, issues req_rate requests/s against the bucket's
+// request budget and takes link_share of each instance NIC. `now` is the
+// simulated clock; store requests and compute advance it, and callers reset
+// it (e.g. to a time of day) before each run.
+struct BackgroundLoad {
+    enum Pattern { Constant, Diurnal, Bursty };
+    Pattern pattern;
+    double bw_share;        // fraction of store throughput consumed at intensity 1
+    double req_rate;        // background requests/s at intensity 1
+    double link_share;      // fraction of NIC bandwidth consumed at intensity 1
+    double amplitude = 0;   // diurnal swing / extra intensity during a burst
+    double period_sec = 86400;  // diurnal period
+    double burst_sec = 60;      // bursty: length of one on/off slot
+    double burst_prob = 0.1;    // bursty: probability a slot is a burst
+    double now = 0;
+
+    double intensity() const {
+        switch (pattern) {
+        case Constant: return 1;
+        case Diurnal: return std::max(0.0, 1 + amplitude * sin(2 * M_PI * now / period_sec));
+        case Bursty: {
+            // deterministic per-slot coin so every run sees the same burst schedule
+            uint64_t slot = uint64_t(now / burst_sec), h = slot * 0x9E3779B97F4A7C15ull;
+            h ^= h >> 31; h *= 0xBF58476D1CE4E5B9ull; h ^= h >> 29;
+            return (h >> 11) * (1.0 / 9007199254740992.0) < burst_prob ? 1 + amplitude : 1;
+        }
+        }
+        return 1;
+    }
+};
+
+// Simulated object store with latency, throughput, variability, and cost characteristics
+struct ObjectStore {
+    double latency_ms;         // base latency per operation
+    double mean_throughput_MBps;    // nominal throughput per stream
+    double throughput_jitter;  // fractional jitter (e.g., 0.2 means ±20%)
+    double cost_per_GB;        // cost per GB transferred
+    double cost_per_request;   // fixed cost per API call
+    double chunk_size_MB;      // chunk size for I/O granularity
+    long get_requests = 0;     // requests issued so far (read/write)
+    long put_requests = 0;
+    double MB_read = 0;        // bytes moved so far
+    double MB_written = 0;
+    double max_requests_per_sec = 0;      // bucket request budget shared by all tenants (0 = unlimited)
+    int job_streams = 1;                  // concurrent streams of this job against the budget
+    BackgroundLoad* background = nullptr; // other tenants, if any
+
+    // Sample a throughput for this operation
+    double sample_throughput() {
+        std::normal_distribution<double> d(mean_throughput_MBps, mean_throughput_MBps * throughput_jitter);
+        return std::max(1.0, d(rng));
+    }
+
+    // Time of one request at sampled throughput thr, after contention from the background load:
+    // a share of the throughput is taken, and when the job's streams need more requests/s than
+    // the budget left over, each request waits for its share of the remaining budget.
+    double request_time(double chunk_MB, double thr) {
+        double load = background ? background->intensity() : 0;
+        if (background) thr *= std::max(0.05, 1 - background->bw_share * load);
+        double t = latency_ms/1000.0 + chunk_MB/thr;
+        if (max_requests_per_sec > 0) {
+            double left = max_requests_per_sec - (background ? background->req_rate * load : 0);
+            t = std::max(t, job_streams / std::max(0.01 * max_requests_per_sec, left));
+        }
+        if (background) background->now += t;
+        return t;
+    }
+
+    // Simulate read: compute time and cost, but do not sleep
+    std::pair<double,double> read(double size_MB) {
+        int num_chunks = ceil(size_MB / chunk_size_MB);
+        double total_time = 0.0, total_cost = 0.0;
+        double remaining = size_MB;
+        for (int i = 0; i < num_chunks; ++i) {
+            double this_chunk = std::min(chunk_size_MB, remaining);
+            remaining -= this_chunk;
+            double thr = sample_throughput();
+            double t = request_time(this_chunk, thr);
+            double c = this_chunk * cost_per_GB / 1024.0 + cost_per_request;
+            total_time += t;
+            total_cost += c;
+        }
+        get_requests += num_chunks;
+        MB_read += size_MB;
+        return {total_time, total_cost};
+    }
+
+    // Simulate write: compute time and cost, but do not sleep
+    std::pair<double,double> write(double size_MB) {
+        int num_chunks = ceil(size_MB / chunk_size_MB);
+        double total_time = 0.0, total_cost = 0.0;
+        double remaining = size_MB;
+        for (int i = 0; i < num_chunks; ++i) {
+            double this_chunk = std::min(chunk_size_MB, remaining);
+            remaining -= this_chunk;
+            double thr = sample_throughput();
+            double t = request_time(this_chunk, thr);
+            double c = this_chunk * cost_per_GB / 1024.0 + cost_per_request;
+            total_time += t;
+            total_cost += c;
+        }
+        put_requests += num_chunks;
+        MB_written += size_MB;
+        return {total_time, total_cost};
+    }
+};
+
+// Fast intermediate tier in front of the object store: a managed in-memory
+// cache or an ephemeral block volume. Capacity is provisioned for the whole
+// job and billed per GB-hour; access is deterministic (no jitter).
+struct FastTier {
+    std::string kind;          // label for reports
+    double capacity_MB;        // provisioned capacity
+    double latency_ms;         // per-request latency
+    double throughput_MBps;    // per-stream throughput
+    double cost_per_GB_hour;   // capacity price
+    double cost_per_request;   // per-request price (0 for block volumes)
+    double chunk_size_MB;      // request granularity
+
+    std::pair<double,double> access(double size_MB) {
+        if (size_MB <= 0) return {0, 0};
+        int num_chunks = ceil(size_MB / chunk_size_MB);
+        double t = num_chunks * latency_ms / 1000.0 + size_MB / throughput_MBps;
+        return {t, num_chunks * cost_per_request};
+    }
+    std::pair<double,double> read(double size_MB) { return access(size_MB); }
+    std::pair<double,double> write(double size_MB) { return access(size_MB); }
+
+    // Capacity rental for a job that keeps the tier provisioned for time_sec
+    double rental(double time_sec) const { return capacity_MB / 1024.0 * cost_per_GB_hour * time_sec / 3600.0; }
+};
+
+// Compression codec applied to runs or merge outputs. Speeds are per thread
+// and in uncompressed MB/s; ratio is uncompressed/compressed size.
+struct Codec {
+    std::string name;
+    double ratio;
+    double compress_MBps;
+    double decompress_MBps;
+};
+
+// Typical general-purpose codec figures (lzbench, fastest levels); a calibrated
+// profile adds measured codecs for the repo's own run codec.
+inline std::vector<Codec> default_codecs() {
+    return {{"lz4", 2.1, 675, 3850}, {"zstd-1", 2.9, 470, 1380}, {"zlib-1", 2.7, 105, 390}};
+}
+
+// Calibrated compute speeds, loaded from the file written by calibrate_compute.
+// Each line fits time_sec = fixed_sec + size_MB / MBps for one kernel at one thread count;
+// merge fits were measured at merge_fanin and scale with log2(fan-in). fixed_sec is
+// the raw least-squares intercept, which noise can make negative; it counts as 0 here.
+struct ComputeFit {
+    int threads;
+    double fixed_sec;
+    double MBps;
+};
+
+struct ComputeProfile {
+    std::vector<ComputeFit> sort_fits;   // sorted by threads
+    std::vector<ComputeFit> merge_fits;  // sorted by threads
+    int merge_fanin = 16;
+    std::vector<Codec> codecs;           // measured run codecs
+
+    bool load(const std::string& path) {
+        std::ifstream f(path);
+        if (!f) return false;
+        std::string line;
+        while (std::getline(f, line)) {
+            if (line.empty() || line[0] == '#') continue;
+            std::istringstream ss(line);
+            std::string kind; ComputeFit fit;
+            if (line.compare(0, 6, "codec ") == 0) {
+                Codec cd;
+                if (ss >> kind >> cd.name >> cd.ratio >> cd.compress_MBps >> cd.decompress_MBps) codecs.push_back(cd);
+                continue;
+            }
+            if (!(ss >> kind >> fit.threads >> fit.fixed_sec >> fit.MBps)) continue;
+            if (kind == "sort") sort_fits.push_back(fit);
+            else if (kind == "merge") { merge_fits.push_back(fit); ss >> merge_fanin; }
+        }
+        auto by_threads = [](const ComputeFit& a, const ComputeFit& b){ return a.threads < b.threads; };
+        std::sort(sort_fits.begin(), sort_fits.end(), by_threads);
+        std::sort(merge_fits.begin(), merge_fits.end(), by_threads);
+        return !sort_fits.empty() && !merge_fits.empty();
+    }
+
+    // Largest calibrated thread count not above `threads` (or the smallest available)
+    static const ComputeFit& pick(const std::vector<ComputeFit>& fits, int threads) {
+        const ComputeFit* best = &fits.front();
+        for (auto& f : fits) if (f.threads <= threads) best = &f;
+        return *best;
+    }
+
+    double sort_time(double size_MB, int threads) const {
+        auto& f = pick(sort_fits, threads);
+        return std::max(0.0, f.fixed_sec) + size_MB / f.MBps;
+    }
+
+    double merge_time(double size_MB, int fanin, int threads) const {
+        auto& f = pick(merge_fits, threads);
+        double levels = log2(std::max(2, fanin)) / log2(std::max(2, merge_fanin));
+        return std::max(0.0, f.fixed_sec) + size_MB * levels / f.MBps;
+    }
+};
+
+// Simulated compute node or function with slowdown probability
+struct ComputeNode {
+    double compute_speed_MBps; // how fast it can sort (used when no profile is loaded)
+    double cost_per_hour;      // compute cost per hour
+    double straggler_prob;     // probability a task is slowed
+    double straggler_factor;   // slowdown multiplier if straggler
+    int threads = 1;                          // worker threads per task
+    const ComputeProfile* profile = nullptr;  // calibrated sort/merge speeds, if any
+    double busy_sec = 0;                      // compute time charged so far
+    BackgroundLoad* background = nullptr;     // clock to advance, if contention is modeled
+
+    // Simulate run generation (in-memory sort): compute time and cost, no sleep
+    std::pair<double,double> sort(double size_MB) {
+        double time_sec = profile ? profile->sort_time(size_MB, threads) : size_MB / compute_speed_MBps;
+        return charge(time_sec);
+    }
+
+    // Simulate a fanin-way merge of size_MB: compute time and cost, no sleep
+    std::pair<double,double> merge(double size_MB, int fanin) {
+        double time_sec = profile ? profile->merge_time(size_MB, fanin, threads) : size_MB / compute_speed_MBps;
+        return charge(time_sec);
+    }
+
+    // Simulate compressing / decompressing size_MB (uncompressed) across all threads
+    std::pair<double,double> compress(double size_MB, const Codec& codec) {
+        return charge(size_MB / (codec.compress_MBps * threads));
+    }
+    std::pair<double,double> decompress(double size_MB, const Codec& codec) {
+        return charge(size_MB / (codec.decompress_MBps * threads));
+    }
+
+    // Apply straggler slowdown and bill the (possibly slowed) time
+    std::pair<double,double> charge(double time_sec) {
+        bool is_straggler = (std::uniform_real_distribution<double>(0,1)(rng) < straggler_prob);
+        if (is_straggler) time_sec *= straggler_factor;
+        busy_sec += time_sec;
+        if (background) background->now += time_sec;
+        double cost = time_sec * (cost_per_hour / 3600.0);
+        return {time_sec, cost};
+    }
+};
+
+// Generate run sizes based on data skew distribution
+inline std::vector<double> generate_run_sizes(double dataset_MB, double avg_run_MB, double skew_alpha) {
+    int num_runs = ceil(dataset_MB / avg_run_MB);
+    std::vector<double> weights(num_runs);
+    for (int i = 1; i <= num_runs; ++i) weights[i-1] = 1.0 / pow(i, skew_alpha);
+    double sum_w = std::accumulate(weights.begin(), weights.end(), 0.0);
+    for (auto &w : weights) w /= sum_w;
+    std::vector<double> sizes(num_runs);
+    for (int i = 0; i < num_runs; ++i) sizes[i] = weights[i] * dataset_MB;
+    return sizes;
+}
+
+// Predicted time, cost and store traffic of one phase (run generation, one merge pass, ...)
+struct SimPhase {
+    std::string name;
+    double time_sec = 0;
+    double cost = 0;
+    double compute_sec = 0;
+    long get_requests = 0;
+    long put_requests = 0;
+    double MB_read = 0;
+    double MB_written = 0;
+    int tasks = 1;           // independent units persisted on completion (e.g. runs)
+    int workers = 1;         // instances running the tasks side by side; time_sec is their span
+};
+
+// Base class for external sort algorithms
+class ExternalSortAlgo {
+public:
+    virtual std::string name() = 0;
+    // Run simulation on dataset_MB; returns time (sec) and cost ($)
+    virtual std::pair<double,double> run(double dataset_MB, ObjectStore& store, ComputeNode& node) = 0;
+    virtual ~ExternalSortAlgo() = default;
+
+    std::vector<SimPhase> phases;  // per-phase breakdown of the last run()
+
+protected:
+    // Close the open phase at cumulative time/cost (t,c) and open `name`; an empty name only closes.
+    // Opening a phase while none is open starts a new breakdown. Store and compute
+    // counters are diffed against the values seen when the phase opened.
+    void phase(const std::string& name, double t, double c, const ObjectStore& store, const ComputeNode& node,
+               int tasks = 1, int workers = 1) {
+        if (!open_.name.empty()) {
+            open_.time_sec = t - open_.time_sec;
+            open_.cost = c - open_.cost;
+            open_.compute_sec = node.busy_sec - open_.compute_sec;
+            open_.get_requests = store.get_requests - open_.get_requests;
+            open_.put_requests = store.put_requests - open_.put_requests;
+            open_.MB_read = store.MB_read - open_.MB_read;
+            open_.MB_written = store.MB_written - open_.MB_written;
+            phases.push_back(open_);
+        } else {
+            phases.clear();
+        }
+        open_ = {name, t, c, node.busy_sec, store.get_requests, store.put_requests, store.MB_read, store.MB_written, tasks, workers};
+    }
+
+private:
+    SimPhase open_;  // while open: name plus the counter values at its start
+};
+
+// Mean time and cost of `trials` runs. Throughput jitter and stragglers make
+// one run a single random draw, too noisy to rank configurations whose
+// expected times are close. With background load, every trial starts at
+// the load clock's value on entry.
+inline std::pair<double,double> mean_run(ExternalSortAlgo& a, double dataset_MB, ObjectStore& store,
+                                         ComputeNode& node, int trials) {
+    double t = 0, c = 0;
+    double clock0 = store.background ? store.background->now : 0;
+    for (int i = 0; i < trials; ++i) {
+        if (store.background) store.background->now = clock0;
+        auto r = a.run(dataset_MB, store, node);
+        t += r.first / trials;
+        c += r.second / trials;
+    }
+    return {t, c};
+}
+
+// 1) Two-Phase Merge Sort (non-skewed)
+class TwoPhaseNoSkew : public ExternalSortAlgo {
+public:
+    std::string name() override { return "Two-Phase Merge Sort (no skew)"; }
+    std::pair<double,double> run(double dataset_MB, ObjectStore& store, ComputeNode& node) override {
+        double chunk = 512;
+        int runs = ceil(dataset_MB / chunk);
+        double t=0,c=0;
+        phase("run_generation",t,c,store,node,runs);
+        // initial runs
+        for(int i=0;i<runs;++i){ auto rd=store.read(chunk); t+=rd.first; c+=rd.second; auto st=node.sort(chunk); t+=st.first; c+=st.second; auto wt=store.write(chunk); t+=wt.first; c+=wt.second; }
+        // merge all
+        phase("merge_pass_1",t,c,store,node);
+        auto rd_all=store.read(dataset_MB); t+=rd_all.first; c+=rd_all.second;
+        auto st_all=node.merge(dataset_MB,runs); t+=st_all.first; c+=st_all.second;
+        auto wt_all=store.write(dataset_MB); t+=wt_all.first; c+=wt_all.second;
+        phase("",t,c,store,node);
+        return {t,c};
+    }
+};
+
+// 2) Two-Phase Merge Sort (skewed)
+class TwoPhaseSkew : public ExternalSortAlgo {
+public:
+    std::string name() override { return "Two-Phase Merge Sort (skewed)"; }
+    std::pair<double,double> run(double dataset_MB, ObjectStore& store, ComputeNode& node) override {
+        auto runs = generate_run_sizes(dataset_MB, 512, 1.1);
+        double t=0,c=0;
+        phase("run_generation",t,c,store,node,runs.size());
+        for(auto sz: runs){ auto rd=store.read(sz); t+=rd.first; c+=rd.second; auto st=node.sort(sz); t+=st.first; c+=st.second; auto wt=store.write(sz); t+=wt.first; c+=wt.second; }
+        phase("merge_pass_1",t,c,store,node);
+        auto rd_all=store.read(dataset_MB); t+=rd_all.first; c+=rd_all.second;
+        auto st_all=node.merge(dataset_MB,runs.size()); t+=st_all.first; c+=st_all.second;
+        auto wt_all=store.write(dataset_MB); t+=wt_all.first; c+=wt_all.second;
+        phase("",t,c,store,node);
+        return {t,c};
+    }
+};
+
+// 3) K-Way Merge Sort (non-skewed)
+class KWayNoSkew : public ExternalSortAlgo {
+    int k;
+    double run_MB;
+public:
+    KWayNoSkew(int k_, double run_MB_=512):k(k_),run_MB(run_MB_){}
+    std::string name() override { return std::string("K-Way Merge Sort (no skew, k=")+std::to_string(k)+")"; }
+    std::pair<double,double> run(double dataset_MB, ObjectStore& store, ComputeNode& node) override {
+        double chunk=run_MB; int runs=ceil(dataset_MB/chunk);
+        int passes=ceil(log(runs)/log(k)); double t=0,c=0;
+        phase("run_generation",t,c,store,node,runs);
+        for(int i=0;i<runs;++i){ auto rd=store.read(chunk); t+=rd.first; c+=rd.second; auto st=node.sort(chunk); t+=st.first; c+=st.second; auto wt=store.write(chunk); t+=wt.first; c+=wt.second; }
+        for(int p=0;p<passes;++p){ phase("merge_pass_"+std::to_string(p+1),t,c,store,node); auto rd=store.read(dataset_MB); t+=rd.first; c+=rd.second; auto st=node.merge(dataset_MB,k); t+=st.first; c+=st.second; auto wt=store.write(dataset_MB); t+=wt.first; c+=wt.second; }
+        phase("",t,c,store,node);
+        return {t,c};
+    }
+};
+
+// 4) K-Way Merge Sort (skewed)
+class KWaySkew : public ExternalSortAlgo {
+    int k;
+public:
+    KWaySkew(int k_):k(k_){}
+    std::string name() override { return std::string("K-Way Merge Sort (skewed, k=")+std::to_string(k)+")"; }
+    std::pair<double,double> run(double dataset_MB, ObjectStore& store, ComputeNode& node) override {
+        auto runs=generate_run_sizes(dataset_MB,512,1.1);
+        int passes=ceil(log(runs.size())/log(k)); double t=0,c=0;
+        phase("run_generation",t,c,store,node,runs.size());
+        for(auto sz:runs){ auto rd=store.read(sz); t+=rd.first; c+=rd.second; auto st=node.sort(sz); t+=st.first; c+=st.second; auto wt=store.write(sz); t+=wt.first; c+=wt.second; }
+        for(int p=0;p<passes;++p){ phase("merge_pass_"+std::to_string(p+1),t,c,store,node); auto rd=store.read(dataset_MB); t+=rd.first; c+=rd.second; auto st=node.merge(dataset_MB,k); t+=st.first; c+=st.second; auto wt=store.write(dataset_MB); t+=wt.first; c+=wt.second; }
+        phase("",t,c,store,node);
+        return {t,c};
+    }
+};
+
+// Where intermediate data (runs and merge-pass outputs) lives. The input is
+// always read from, and the final output always written to, the object store.
+enum class Placement {
+    ObjectStoreOnly,   // no fast tier (baseline)
+    AllFast,           // everything in the fast tier; infeasible if it does not fit
+    SpillOnOverflow,   // fast tier until full, the rest in the object store
+    MergePassOnly,     // initial runs in the object store, intermediate merge outputs in the fast tier
+};
+
+inline std::string placement_name(Placement p) {
+    switch (p) {
+    case Placement::ObjectStoreOnly: return "object-store-only";
+    case Placement::AllFast: return "all-fast";
+    case Placement::SpillOnOverflow: return "spill-on-overflow";
+    case Placement::MergePassOnly: return "merge-pass-only";
+    }
+    return "?";
+}
+
+// 5) K-Way Merge Sort over a fast tier + object store hierarchy (non-skewed).
+// Merge passes stream their inputs, so a pass's output reuses the space its
+// inputs free; the fast tier holds at most capacity_MB of intermediate data.
+class TieredKWay : public ExternalSortAlgo {
+    int k;
+    FastTier& tier;
+    Placement policy;
+    double run_MB;
+
+    // Read/write size_MB of which fast_MB sits in the fast tier
+    std::pair<double,double> io(double size_MB, double fast_MB, ObjectStore& store, bool is_write) {
+        auto f = is_write ? tier.write(fast_MB) : tier.read(fast_MB);
+        double rest = size_MB - fast_MB;
+        auto o = rest <= 0 ? std::pair<double,double>{0, 0} : (is_write ? store.write(rest) : store.read(rest));
+        return {f.first + o.first, f.second + o.second};
+    }
+
+public:
+    TieredKWay(int k_, FastTier& tier_, Placement policy_, double run_MB_=512)
+        : k(k_), tier(tier_), policy(policy_), run_MB(run_MB_) {}
+    std::string name() override {
+        return "Tiered K-Way Merge Sort (k="+std::to_string(k)+", "+tier.kind+", "+placement_name(policy)+")";
+    }
+    // Returns {inf, inf} when the policy cannot be satisfied (all-fast with too little capacity)
+    std::pair<double,double> run(double dataset_MB, ObjectStore& store, ComputeNode& node) override {
+        if (policy==Placement::AllFast && dataset_MB>tier.capacity_MB) { phases.clear(); return {INFINITY,INFINITY}; }
+        double cap = policy==Placement::ObjectStoreOnly ? 0 : tier.capacity_MB;
+        double chunk=run_MB; int runs=ceil(dataset_MB/chunk);
+        int passes=ceil(log(runs)/log(k)); double t=0,c=0;
+        phase("run_generation",t,c,store,node,runs);
+        double fast=0; // intermediate MB currently in the fast tier
+        bool runs_fast = policy==Placement::AllFast || policy==Placement::SpillOnOverflow;
+        for(int i=0;i<runs;++i){
+            double sz=std::min(chunk,dataset_MB-i*chunk);
+            double f = runs_fast ? std::max(0.0,std::min(sz,cap-fast)) : 0;
+            fast+=f;
+            auto rd=store.read(sz); t+=rd.first; c+=rd.second;
+            auto st=node.sort(sz); t+=st.first; c+=st.second;
+            auto wt=io(sz,f,store,true); t+=wt.first; c+=wt.second;
+        }
+        for(int p=0;p<passes;++p){
+            phase("merge_pass_"+std::to_string(p+1),t,c,store,node);
+            bool last = p==passes-1;
+            double out_fast = last ? 0 : std::min(cap,dataset_MB);
+            auto rd=io(dataset_MB,fast,store,false); t+=rd.first; c+=rd.second;
+            auto st=node.merge(dataset_MB,k); t+=st.first; c+=st.second;
+            auto wt=last ? store.write(dataset_MB) : io(dataset_MB,out_fast,store,true); t+=wt.first; c+=wt.second;
+            fast=out_fast;
+        }
+        phase("",t,c,store,node);
+        if(cap>0) c+=tier.rental(t); // provisioned for the whole job, outside any phase
+        return {t,c};
+    }
+};
+
+// 6) K-Way Merge Sort with compressed intermediate data (non-skewed).
+// compress_runs stores the initial runs compressed; compress_merges does the
+// same for intermediate merge-pass outputs. Input and final output stay raw.
+class CompressedKWay : public ExternalSortAlgo {
+    int k;
+    Codec codec;
+    bool compress_runs, compress_merges;
+    double run_MB;
+public:
+    CompressedKWay(int k_, const Codec& codec_, bool runs_, bool merges_, double run_MB_=512)
+        : k(k_), codec(codec_), compress_runs(runs_), compress_merges(merges_), run_MB(run_MB_) {}
+    std::string name() override {
+        return "Compressed K-Way Merge Sort (k="+std::to_string(k)+", "+codec.name+
+               (compress_runs?", runs":"")+(compress_merges?", merges":"")+")";
+    }
+    std::pair<double,double> run(double dataset_MB, ObjectStore& store, ComputeNode& node) override {
+        double chunk=run_MB; int runs=ceil(dataset_MB/chunk);
+        int passes=ceil(log(runs)/log(k)); double t=0,c=0;
+        auto add=[&](std::pair<double,double> r){ t+=r.first; c+=r.second; };
+        phase("run_generation",t,c,store,node,runs);
+        for(int i=0;i<runs;++i){
+            add(store.read(chunk)); add(node.sort(chunk));
+            if(compress_runs){ add(node.compress(chunk,codec)); add(store.write(chunk/codec.ratio)); }
+            else add(store.write(chunk));
+        }
+        bool in_compressed=compress_runs;
+        for(int p=0;p<passes;++p){
+            phase("merge_pass_"+std::to_string(p+1),t,c,store,node);
+            bool out_compressed = compress_merges && p<passes-1;
+            if(in_compressed){ add(store.read(dataset_MB/codec.ratio)); add(node.decompress(dataset_MB,codec)); }
+            else add(store.read(dataset_MB));
+            add(node.merge(dataset_MB,k));
+            if(out_compressed){ add(node.compress(dataset_MB,codec)); add(store.write(dataset_MB/codec.ratio)); }
+            else add(store.write(dataset_MB));
+            in_compressed=out_compressed;
+        }
+        phase("",t,c,store,node);
+        return {t,c};
+    }
+};
+
+// Merge schedules with exact bytes per merge. A schedule is the list of
+// merges to perform, each reading and writing the sum of its input runs.
+// Runs that pass through a step unchanged (one real input, or dummy runs
+// only) cost nothing.
+struct MergeStep {
+    int pass;     // pass / phase the merge belongs to (1-based)
+    double MB;    // bytes read and written by this merge
+    int fanin;    // real (non-dummy) inputs
+};
+
+enum class MergeScheme {
+    Balanced,          // k-way passes over all runs; a lone leftover run is carried over
+    PartialFirstPass,  // smallest-first; the first merge takes just enough runs that every later one is k-way
+    Polyphase,         // k+1 sequences, Fibonacci-style run distribution
+    Cascade,           // k+1 sequences, k-way then (k-1)-way ... 2-way per pass
+};
+
+inline std::string merge_scheme_name(MergeScheme m) {
+    switch (m) {
+    case MergeScheme::Balanced: return "balanced";
+    case MergeScheme::PartialFirstPass: return "partial-first-pass";
+    case MergeScheme::Polyphase: return "polyphase";
+    case MergeScheme::Cascade: return "cascade";
+    }
+    return "?";
+}
+
+// Spread runs over k input sequences following a perfect distribution (level
+// counts from `next`), padding with dummy (0 MB) runs at the sequence fronts.
+template <typename Next>
+inline std::vector<std::deque<double>> distribute_runs(const std::vector<double>& runs, int k, Next next) {
+    std::vector<long> dist(k, 0);
+    dist[0] = 1;
+    while (std::accumulate(dist.begin(), dist.end(), 0L) < long(runs.size())) {
+        std::sort(dist.rbegin(), dist.rend());
+        dist = next(dist);
+    }
+    std::vector<std::deque<double>> seqs(k + 1);  // seqs[k] starts as the empty output
+    long dummies = std::accumulate(dist.begin(), dist.end(), 0L) - long(runs.size());
+    std::vector<long> dummy(k, 0);
+    for (int i = 0; dummies > 0; i = (i + 1) % k)
+        if (dummy[i] < dist[i]) { ++dummy[i]; --dummies; }
+    size_t r = 0;
+    for (int i = 0; i < k; ++i) {
+        seqs[i].assign(dummy[i], 0.0);
+        for (long j = dummy[i]; j < dist[i]; ++j) seqs[i].push_back(runs[r++]);
+    }
+    return seqs;
+}
+
+// Merge the front run of every sequence in `from` onto `to`, n times
+inline void merge_fronts(std::vector<std::deque<double>>& seqs, const std::vector<int>& from, int to,
+                         long n, int pass, std::vector<MergeStep>& steps) {
+    for (long j = 0; j < n; ++j) {
+        double sum = 0;
+        int fanin = 0;
+        for (int i : from) { sum += seqs[i].front(); fanin += seqs[i].front() > 0; seqs[i].pop_front(); }
+        if (fanin >= 2) steps.push_back({pass, sum, fanin});
+        seqs[to].push_back(sum);
+    }
+}
+
+inline long runs_left(const std::vector<std::deque<double>>& seqs) {
+    long n = 0;
+    for (auto& q : seqs) n += q.size();
+    return n;
+}
+
+inline std::vector<MergeStep> merge_schedule(const std::vector<double>& runs, int k, MergeScheme scheme) {
+    std::vector<MergeStep> steps;
+    k = std::max(2, k);
+    if (runs.size() <= 1) return steps;
+
+    if (scheme == MergeScheme::Balanced) {
+        std::vector<double> cur = runs;
+        for (int pass = 1; cur.size() > 1; ++pass) {
+            std::vector<double> next;
+            for (size_t b = 0; b < cur.size(); b += k) {
+                size_t e = std::min(cur.size(), b + k);
+                double sum = std::accumulate(cur.begin() + b, cur.begin() + e, 0.0);
+                if (e - b > 1) steps.push_back({pass, sum, int(e - b)});
+                next.push_back(sum);
+            }
+            cur = next;
+        }
+    } else if (scheme == MergeScheme::PartialFirstPass) {
+        // k-ary Huffman: optimal total merge bytes; pass = height of the merge tree node
+        typedef std::pair<double,int> Run;  // size, pass that produced it
+        std::priority_queue<Run, std::vector<Run>, std::greater<Run>> heap;
+        for (double r : runs) heap.push({r, 0});
+        size_t take = (runs.size() - 2) % (k - 1) + 2;
+        while (heap.size() > 1) {
+            double sum = 0;
+            int pass = 0;
+            for (size_t i = 0; i < take; ++i) { sum += heap.top().first; pass = std::max(pass, heap.top().second); heap.pop(); }
+            steps.push_back({pass + 1, sum, int(take)});
+            heap.push({sum, pass + 1});
+            take = k;
+        }
+        std::stable_sort(steps.begin(), steps.end(), [](const MergeStep& a, const MergeStep& b){ return a.pass < b.pass; });
+    } else if (scheme == MergeScheme::Polyphase) {
+        auto seqs = distribute_runs(runs, k, [k](const std::vector<long>& d) {
+            std::vector<long> n(k);
+            for (int i = 0; i + 1 < k; ++i) n[i] = d[0] + d[i + 1];
+            n[k - 1] = d[0];
+            return n;
+        });
+        int out = k;
+        for (int pass = 1; runs_left(seqs) > 1; ++pass) {
+            std::vector<int> from;
+            long n = -1;
+            for (int i = 0; i <= k; ++i)
+                if (i != out) { from.push_back(i); n = n < 0 ? long(seqs[i].size()) : std::min(n, long(seqs[i].size())); }
+            merge_fronts(seqs, from, out, n, pass, steps);
+            for (int i : from) if (seqs[i].empty()) { out = i; break; }
+        }
+    } else {
+        auto seqs = distribute_runs(runs, k, [k](const std::vector<long>& d) {
+            std::vector<long> n(k);
+            for (int i = 0; i < k; ++i) n[i] = std::accumulate(d.begin(), d.begin() + (k - i), 0L);
+            return n;
+        });
+        int out = k;
+        for (int pass = 1; runs_left(seqs) > 1; ++pass) {
+            std::vector<int> active;
+            for (int i = 0; i <= k; ++i) if (i != out) active.push_back(i);
+            int dest = out;
+            // k-way, then (k-1)-way, ... onto the sequence emptied by the previous step
+            while (active.size() >= 2) {
+                auto smallest = std::min_element(active.begin(), active.end(),
+                    [&](int a, int b){ return seqs[a].size() < seqs[b].size(); });
+                merge_fronts(seqs, active, dest, seqs[*smallest].size(), pass, steps);
+                dest = *smallest;
+                active.erase(smallest);
+            }
+            out = dest;  // the last 1-way copy is skipped: the remaining runs stay in place
+        }
+    }
+    return steps;
+}
+
+// 7) Merge sort with an explicit merge schedule, charging each merge for
+// exactly the bytes it reads and writes instead of full-dataset passes.
+class ScheduledMergeSort : public ExternalSortAlgo {
+    int k;
+    MergeScheme scheme;
+    bool skewed;
+    double run_MB;
+public:
+    ScheduledMergeSort(int k_, MergeScheme scheme_, bool skewed_=false, double run_MB_=512)
+        : k(k_), scheme(scheme_), skewed(skewed_), run_MB(run_MB_) {}
+    std::string name() override {
+        return "Scheduled Merge Sort ("+merge_scheme_name(scheme)+(skewed?", skewed":", no skew")+", k="+std::to_string(k)+")";
+    }
+    std::pair<double,double> run(double dataset_MB, ObjectStore& store, ComputeNode& node) override {
+        std::vector<double> runs;
+        if (skewed) runs = generate_run_sizes(dataset_MB, run_MB, 1.1);
+        else for (double left = dataset_MB; left > 0; left -= run_MB) runs.push_back(std::min(run_MB, left));
+        double t=0,c=0;
+        auto add=[&](std::pair<double,double> r){ t+=r.first; c+=r.second; };
+        phase("run_generation",t,c,store,node,runs.size());
+        for(auto sz:runs){ add(store.read(sz)); add(node.sort(sz)); add(store.write(sz)); }
+        int pass=0;
+        for(auto& m: merge_schedule(runs,k,scheme)){
+            if(m.pass!=pass){ pass=m.pass; phase("merge_pass_"+std::to_string(pass),t,c,store,node); }
+            add(store.read(m.MB)); add(node.merge(m.MB,m.fanin)); add(store.write(m.MB));
+        }
+        phase("",t,c,store,node);
+        return {t,c};
+    }
+};
+
+// A pool of identical instances available to the cluster
+struct InstancePool {
+    std::string name;
+    ComputeNode node;     // sort/merge speed, hourly price, stragglers
+    double nic_MBps;      // per-instance network bandwidth
+    double memory_MB;     // bounds run size and merge fan-in
+    int available;        // instances obtainable from this pool
+    int io_streams = 8;   // concurrent object-store streams per instance
+};
+
+// Which pool (and how many instances) runs each phase
+struct ClusterPlan {
+    int gen_pool, gen_count;      // run generation
+    int merge_pool, merge_count;  // merge passes
+};
+
+// 8) K-Way Merge Sort on a heterogeneous cluster (non-skewed). Runs are dealt
+// round-robin to the generation instances; every merge pass is range-
+// partitioned evenly over the merge instances. Each instance moves data over
+// io_streams parallel store streams, capped by its NIC. Runs use at most half
+// of a generation instance's memory and the merge fan-in is limited to the
+// number of chunk_size_MB buffers that fit in a merge instance. Instances are
+// billed for their uptime in each phase. The `node` argument of run() is unused.
+class ClusterKWay : public ExternalSortAlgo {
+    std::vector<InstancePool> pools;
+    ClusterPlan plan;
+    int k;
+    double run_MB;
+
+    // Wall time and store cost for one instance moving size_MB. The streams run
+    // concurrently, so each starts from the same background clock.
+    std::pair<double,double> transfer(double size_MB, const InstancePool& pool, ObjectStore& store, bool is_write) {
+        double t = 0, c = 0, part = size_MB / pool.io_streams;
+        BackgroundLoad* bg = store.background;
+        double start = bg ? bg->now : 0;
+        double nic = pool.nic_MBps * (bg ? std::max(0.05, 1 - bg->link_share * bg->intensity()) : 1);
+        for (int s = 0; s < pool.io_streams; ++s) {
+            if (bg) bg->now = start;
+            auto r = is_write ? store.write(part) : store.read(part);
+            t = std::max(t, r.first);
+            c += r.second;
+        }
+        t = std::max(t, size_MB / nic);
+        if (bg) bg->now = start + t;
+        return {t, c};
+    }
+
+    // Parallel instances all start a phase at the same clock value
+    static void rewind(ObjectStore& store, double t0) { if (store.background) store.background->now = t0; }
+
+public:
+    ClusterKWay(const std::vector<InstancePool>& pools_, const ClusterPlan& plan_, int k_, double run_MB_=512)
+        : pools(pools_), plan(plan_), k(k_), run_MB(run_MB_) {}
+    std::string name() override {
+        return "Cluster K-Way Merge Sort (gen "+std::to_string(plan.gen_count)+"x "+pools[plan.gen_pool].name+
+               ", merge "+std::to_string(plan.merge_count)+"x "+pools[plan.merge_pool].name+")";
+    }
+    std::pair<double,double> run(double dataset_MB, ObjectStore& store, ComputeNode&) override {
+        InstancePool gen = pools[plan.gen_pool], mrg = pools[plan.merge_pool];
+        double chunk = std::min(run_MB, gen.memory_MB / 2);
+        int kk = std::max(2, std::min(k, int(mrg.memory_MB / store.chunk_size_MB) - 1));
+        int runs = ceil(dataset_MB / chunk);
+        int passes = ceil(log(runs) / log(kk));
+        ComputeNode tally{0, 0, 0, 1};  // accumulates per-phase compute for the breakdown
+        double t = 0, c = 0;
+        double clock0 = store.background ? store.background->now : 0;
+        int own_streams = store.job_streams;
+
+        phase("run_generation", t, c, store, tally, runs, plan.gen_count);
+        store.job_streams = plan.gen_count * gen.io_streams;
+        std::vector<double> busy(plan.gen_count, 0);
+        for (int r = 0; r < runs; ++r) {
+            double sz = std::min(chunk, dataset_MB - r * chunk);
+            double& b = busy[r % plan.gen_count];
+            rewind(store, clock0 + t + b);
+            auto rd = transfer(sz, gen, store, false);
+            double st = gen.node.sort(sz).first;
+            rewind(store, clock0 + t + b + rd.first + st);
+            auto wt = transfer(sz, gen, store, true);
+            b += rd.first + st + wt.first;
+            tally.busy_sec += st;
+            c += rd.second + wt.second;
+        }
+        double span = *std::max_element(busy.begin(), busy.end());
+        t += span;
+        c += plan.gen_count * span * gen.node.cost_per_hour / 3600.0;
+
+        double share = dataset_MB / plan.merge_count;
+        store.job_streams = plan.merge_count * mrg.io_streams;
+        for (int p = 0; p < passes; ++p) {
+            phase("merge_pass_" + std::to_string(p + 1), t, c, store, tally, plan.merge_count, plan.merge_count);
+            span = 0;
+            for (int i = 0; i < plan.merge_count; ++i) {
+                rewind(store, clock0 + t);
+                auto rd = transfer(share, mrg, store, false);
+                double mt = mrg.node.merge(share, kk).first;
+                rewind(store, clock0 + t + rd.first + mt);
+                auto wt = transfer(share, mrg, store, true);
+                span = std::max(span, rd.first + mt + wt.first);
+                tally.busy_sec += mt;
+                c += rd.second + wt.second;
+            }
+            t += span;
+            c += plan.merge_count * span * mrg.node.cost_per_hour / 3600.0;
+        }
+        store.job_streams = own_streams;
+        rewind(store, clock0 + t);
+        phase("", t, c, store, tally);
+        return {t, c};
+    }
+};
+
+// Cheapest plan over all pool pairs (or only same-pool plans) and power-of-two
+// instance counts whose mean time over `trials` runs is within deadline_sec
+// (0 = no deadline). Plans are ranked by mean cost: a single run includes
+// jitter and stragglers, which can outweigh the gap between two plans. Every
+// plan replays the same random draws (the generator is left as it was), so
+// the comparison is not swayed by which plan drew the slower streams. Phases
+// run one after the other, so both may use the same pool's instances.
+// Returns {plan, {mean time, mean cost}}; cost is infinite when no plan meets
+// the deadline.
+inline std::pair<ClusterPlan, std::pair<double,double>>
+cheapest_cluster_plan(const std::vector<InstancePool>& pools, double dataset_MB, ObjectStore& store,
+                      int k, double deadline_sec = 0, bool single_pool = false, int trials = 20) {
+    ClusterPlan best{0, 1, 0, 1};
+    std::pair<double,double> best_r{INFINITY, INFINITY};
+    ComputeNode unused{0, 0, 0, 1};
+    const RNG draws = rng;
+    for (int g = 0; g < int(pools.size()); ++g)
+        for (int m = 0; m < int(pools.size()); ++m) {
+            if (single_pool && g != m) continue;
+            for (int ng = 1; ng <= pools[g].available; ng *= 2)
+                for (int nm = 1; nm <= pools[m].available; nm *= 2) {
+                    ClusterPlan plan{g, ng, m, nm};
+                    ClusterKWay a(pools, plan, k);
+                    rng = draws;
+                    auto r = mean_run(a, dataset_MB, store, unused, trials);
+                    if (deadline_sec > 0 && r.first > deadline_sec) continue;
+                    if (r.second < best_r.second) { best = plan; best_r = r; }
+                }
+        }
+    rng = draws;
+    return {best, best_r};
+}
+
+// 9) Pull-based shuffle sort (M mappers, R reducers). Each mapper reads its
+// 1/M of the input, sorts it into R range partitions and writes them as R
+// objects; after a barrier each reducer fetches its M objects (M x R small
+// requests in total), merges them M-way and writes 1/R of the output.
+// Mappers and reducers are billed for the phases they run in.
+class PullShuffleSort : public ExternalSortAlgo {
+    int M, R;
+public:
+    PullShuffleSort(int M_, int R_) : M(M_), R(R_) {}
+    std::string name() override { return "Pull Shuffle Sort (M="+std::to_string(M)+", R="+std::to_string(R)+")"; }
+    std::pair<double,double> run(double dataset_MB, ObjectStore& store, ComputeNode& node) override {
+        double in_MB = dataset_MB / M, part_MB = in_MB / R, out_MB = dataset_MB / R;
+        double rate = node.cost_per_hour / 3600.0;
+        double t=0,c=0;
+        phase("map",t,c,store,node,M,M);
+        double span=0;
+        for(int m=0;m<M;++m){
+            auto rd=store.read(in_MB); double tm=rd.first; c+=rd.second;
+            tm+=node.sort(in_MB).first;
+            for(int r=0;r<R;++r){ auto wt=store.write(part_MB); tm+=wt.first; c+=wt.second; }
+            span=std::max(span,tm);
+        }
+        t+=span; c+=M*span*rate;
+        phase("reduce",t,c,store,node,R,R);
+        span=0;
+        for(int r=0;r<R;++r){
+            double tr=0;
+            for(int m=0;m<M;++m){ auto rd=store.read(part_MB); tr+=rd.first; c+=rd.second; }
+            tr+=node.merge(out_MB,M).first;
+            auto wt=store.write(out_MB); tr+=wt.first; c+=wt.second;
+            span=std::max(span,tr);
+        }
+        t+=span; c+=R*span*rate;
+        phase("",t,c,store,node);
+        return {t,c};
+    }
+    // Merge buffers a reducer holds: one store chunk per mapper
+    double reducer_memory_MB(const ObjectStore& store) const { return M * store.chunk_size_MB; }
+};
+
+// 10) Push-based shuffle sort with merge-on-receive. Mappers read and sort
+// their input in run_MB rounds and push each round's R partitions over the
+// network straight to R reducer-side mergers, overlapping with the next
+// round's read and sort. Mergers fold incoming partitions into an in-memory
+// sorted run; beyond buffer_MB they spill sorted runs to the object store
+// (with no buffer, every mapper's push is spilled as it arrives).
+// Push throughput is the minimum of mapper egress, reducer ingest and the
+// reducers' merge rate, so slow mergers backpressure the mappers. After the
+// last push each reducer merges its spills with the in-memory run and writes
+// its output. Reducers are up for the whole job.
+class PushShuffleSort : public ExternalSortAlgo {
+    int M, R;
+    double link_MBps;   // per-node network bandwidth
+    double buffer_MB;   // per-reducer merge buffer
+    double run_MB;      // mapper round size
+public:
+    PushShuffleSort(int M_, int R_, double link_MBps_, double buffer_MB_, double run_MB_=512)
+        : M(M_), R(R_), link_MBps(link_MBps_), buffer_MB(buffer_MB_), run_MB(run_MB_) {}
+    std::string name() override {
+        return "Push Shuffle Sort (M="+std::to_string(M)+", R="+std::to_string(R)+
+               ", buffer "+std::to_string(int(buffer_MB))+" MB)";
+    }
+    std::pair<double,double> run(double dataset_MB, ObjectStore& store, ComputeNode& node) override {
+        double in_MB = dataset_MB / M, out_MB = dataset_MB / R;
+        double rate = node.cost_per_hour / 3600.0;
+        bool buffered = buffer_MB > 0;
+        double spill_MB = buffered ? std::max(0.0, out_MB - buffer_MB) : out_MB;
+        double piece_MB = buffered ? buffer_MB : out_MB / M;  // size of one spill
+        int spills = buffered ? int(ceil(spill_MB / piece_MB)) : M;
+        double t=0,c=0;
+
+        phase("map_push",t,c,store,node,M,M);
+        // reducer side: each reducer's incremental merge rate, slowed by its spill
+        // writes while receiving; every mapper sends each reducer an equal share,
+        // so the slowest reducer sets the ingest rate
+        double ingest_MBps = link_MBps;
+        for(int r=0;r<R;++r){
+            double ts=node.merge(out_MB, M).first;
+            for(int i=0;i<spills;++i){ auto wt=store.write(std::min(piece_MB, spill_MB-i*piece_MB)); ts+=wt.first; c+=wt.second; }
+            ingest_MBps=std::min(ingest_MBps, out_MB / ts);
+        }
+        double push_MBps = std::min(M * link_MBps, R * ingest_MBps) / M;  // per mapper, after backpressure
+        // mapper side: two-stage pipeline (read+sort | push) over rounds
+        int rounds = ceil(in_MB / run_MB);
+        double span=0;
+        for(int m=0;m<M;++m){
+            double stage_a=0;
+            for(int i=0;i<rounds;++i){
+                double sz=std::min(run_MB, in_MB-i*run_MB);
+                auto rd=store.read(sz); c+=rd.second;
+                stage_a=std::max(stage_a, rd.first+node.sort(sz).first);
+            }
+            double stage_b = std::min(run_MB, in_MB) / push_MBps;
+            span=std::max(span, stage_a + stage_b + (rounds-1)*std::max(stage_a, stage_b));
+        }
+        t+=span;
+
+        phase("merge_tail",t,c,store,node,R,R);
+        double tail=0;
+        for(int r=0;r<R;++r){
+            double tr=0;
+            if(spills>0){
+                auto rd=store.read(spill_MB); tr+=rd.first; c+=rd.second;
+                tr+=node.merge(out_MB, spills+(buffered?1:0)).first;
+            }
+            auto wt=store.write(out_MB); tr+=wt.first; c+=wt.second;
+            tail=std::max(tail,tr);
+        }
+        t+=tail;
+        c+=M*span*rate + R*t*rate;
+        phase("",t,c,store,node);
+        return {t,c};
+    }
+    // Merge buffer plus one incoming partition per mapper in flight
+    double reducer_memory_MB(double dataset_MB) const { return buffer_MB + M * std::min(run_MB, dataset_MB / M) / R; }
+};
+
+// Break-even of a codec on a store/compute pair, per uncompressed MB of
+// intermediate data that is written once and read back once. Codec time is
+// the expected time under the node's straggler slowdown, as charged by the
+// simulation.
+struct CodecBreakEven {
+    double store_MBps;      // store throughput below which compression saves time (bandwidth term only)
+    double time_saved_sec;  // per MB at the store's mean throughput (negative = slower)
+    double cost_saved;      // per MB, transfer/requests saved minus compute billed
+};
+
+inline CodecBreakEven codec_break_even(const Codec& codec, const ObjectStore& store, const ComputeNode& node) {
+    double saved_MB = 2 * (1 - 1 / codec.ratio);  // one write + one read
+    double slowdown = 1 + node.straggler_prob * (node.straggler_factor - 1);
+    double cpu_sec = (1 / codec.compress_MBps + 1 / codec.decompress_MBps) / node.threads * slowdown;
+    double io_saved = saved_MB / store.mean_throughput_MBps
+                    + 2 * (1 - 1 / codec.ratio) / store.chunk_size_MB * store.latency_ms / 1000.0;
+    double req_saved = 2 * (1 - 1 / codec.ratio) / store.chunk_size_MB * store.cost_per_request;
+    CodecBreakEven b;
+    b.store_MBps = cpu_sec > 0 ? saved_MB / cpu_sec : INFINITY;
+    b.time_saved_sec = io_saved - cpu_sec;
+    b.cost_saved = saved_MB * store.cost_per_GB / 1024.0 + req_saved
+                 + b.time_saved_sec * node.cost_per_hour / 3600.0;
+    return b;
+}
+
+// Spot/preemptible capacity. Interruption notices arrive as a Poisson process
+// with hazard_per_hour; the instance is reclaimed notice_sec after the notice
+// and a replacement resumes the job after restart_sec. Recovery follows what
+// the object store keeps: completed runs survive, an in-flight run is redone,
+// and an in-flight merge either restarts from scratch or, with
+// merge_checkpoints, resumes from the last fence-pointer checkpoint (output
+// parts written so far plus the read offset of every input run).
+struct SpotModel {
+    double hazard_per_hour;   // interruption notices per instance-hour
+    double notice_sec;        // warning between notice and reclaim
+    double restart_sec;       // time to get a replacement instance running
+    double price_fraction;    // spot price as a fraction of on-demand
+    bool merge_checkpoints;   // merges resume from fence pointers instead of restarting
+    double checkpoint_MB;     // merge output written between two checkpoints
+    long interruptions = 0;   // reclaims seen so far
+
+    // Wall time to finish work_sec of work that persists progress every ckpt_sec (0 = only at the end)
+    double run_task(double work_sec, double ckpt_sec) {
+        if (hazard_per_hour <= 0) return work_sec;
+        std::exponential_distribution<double> next_notice(hazard_per_hour / 3600.0);
+        double wall = 0, done = 0;
+        for (;;) {
+            double x = next_notice(rng);
+            if (done + x + notice_sec >= work_sec) return wall + (work_sec - done);
+            double reached = done + x + notice_sec;
+            if (ckpt_sec > 0) done = std::floor(reached / ckpt_sec) * ckpt_sec;
+            wall += x + notice_sec + restart_sec;
+            ++interruptions;
+        }
+    }
+
+    // Replay a fault-free phase breakdown under interruptions; returns {time, cost}.
+    // A phase's tasks are dealt round-robin to its workers, each running its
+    // share back to back, and the phase ends with the slowest worker. Redone
+    // work repeats its share of store requests and compute, and compute
+    // (including restarts) is billed at the spot price.
+    std::pair<double,double> replay(const std::vector<SimPhase>& phases, const ComputeNode& node) {
+        double t = 0, c = 0;
+        double rate = node.cost_per_hour / 3600.0;
+        for (auto& p : phases) {
+            bool is_merge = p.name.compare(0, 5, "merge") == 0;
+            int tasks = std::max(1, p.tasks);
+            int workers = std::max(1, std::min(p.workers, tasks));
+            int per_worker = (tasks + workers - 1) / workers;  // tasks on the busiest worker
+            double task_sec = p.time_sec / per_worker;
+            double ckpt = 0;  // each task writes its 1/tasks of the phase's output
+            if (is_merge && merge_checkpoints && p.MB_written > 0)
+                ckpt = task_sec * std::min(1.0, checkpoint_MB * tasks / p.MB_written);
+            double wall = 0, busy = 0;
+            long before = interruptions;
+            for (int w = 0; w < workers; ++w) {
+                double ww = 0;
+                for (int i = w; i < tasks; i += workers) ww += run_task(task_sec, ckpt);
+                wall = std::max(wall, ww);
+                busy += ww;
+            }
+            double gaps = (interruptions - before) * restart_sec;
+            double work = tasks * task_sec;  // fault-free busy time over all workers
+            double redo = work > 0 ? (busy - gaps) / work : 1;  // >= 1
+            double compute_cost = p.compute_sec * rate;
+            double store_cost = p.cost - compute_cost;
+            t += wall;
+            c += redo * (store_cost + compute_cost * price_fraction) + gaps * rate * price_fraction;
+        }
+        return {t, c};
+    }
+};
@@ -0,0 +1,423 @@
+// radix_kernels.cl
+// LSD radix sort of 64-bit keys, one BITS-wide digit per pass.
+// Each pass is four launches that stay on the device:
+//   build_group_histogram  per-group digit counts             gh[g*RADIX + d]
+//   reduce_group_blocks    per-digit sums of SCAN_BLOCK groups bs[b*RADIX + d]
+//   scan_digit_blocks      top-level scan: block offsets in bs, digit offsets pg
+//   scan_group_offsets     per-group offsets within each digit go[g*RADIX + d]
+// followed by scatter_stable, which places key i of group g with digit d at
+// pg[d] + go[g*RADIX + d] + (rank of i among the group's keys with digit d),
+// or scatter_local, which sorts the group's keys by digit in local memory
+// first so each digit's keys go out as one contiguous run. A group covers a
+// tile of SCATTER_TILE keys, ROWS rows of one key per work-item.
+// The scan kernels run with one work-item per digit (local size RADIX).
+// Key counts, histograms and offsets are OFFSET_T: uint, or ulong for sorts
+// of 2^32 keys and more.
+
+#ifndef BITS
+#define BITS 8
+#endif
+#ifndef LOCAL_SZ
+#define LOCAL_SZ 256
+#endif
+#ifndef SCAN_BLOCK
+#define SCAN_BLOCK 64
+#endif
+#ifndef OFFSET_T
+#define OFFSET_T uint
+#endif
+#ifndef SCATTER_TILE
+#define SCATTER_TILE LOCAL_SZ
+#endif
+#define RADIX (1 << BITS)
+#define ROWS (SCATTER_TILE / LOCAL_SZ)
+
+__kernel void build_group_histogram(__global const ulong* in,
+                                    __global OFFSET_T*    gh,
+                                    OFFSET_T N, uint shift)
+{
+    __local uint hist[RADIX];
+    uint lid = get_local_id(0);
+    OFFSET_T grp = get_group_id(0);
+    for (uint d = lid; d < RADIX; d += LOCAL_SZ) hist[d] = 0;
+    barrier(CLK_LOCAL_MEM_FENCE);
+    for (uint r = 0; r < ROWS; ++r) {
+        OFFSET_T i = grp * SCATTER_TILE + r * LOCAL_SZ + lid;
+        if (i < N) atomic_inc(&hist[(in[i] >> shift) & (RADIX - 1)]);
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+    // every group stores its whole row, so gh needs no clearing between passes
+    for (uint d = lid; d < RADIX; d += LOCAL_SZ) gh[grp * RADIX + d] = hist[d];
+}
+
+// One work-group per block of SCAN_BLOCK groups
+__kernel void reduce_group_blocks(__global const OFFSET_T* gh,
+                                  __global OFFSET_T*       bs,
+                                  OFFSET_T num_groups)
+{
+    uint d = get_local_id(0);
+    OFFSET_T b = get_group_id(0);
+    OFFSET_T g1 = min(b * SCAN_BLOCK + SCAN_BLOCK, num_groups);
+    OFFSET_T sum = 0;
+    for (OFFSET_T g = b * SCAN_BLOCK; g < g1; ++g) sum += gh[g * RADIX + d];
+    bs[b * RADIX + d] = sum;
+}
+
+// Single work-group: exclusive scan of block sums per digit (in place), then a
+// work-group scan of the digit totals into pg
+__kernel void scan_digit_blocks(__global OFFSET_T* bs,
+                                __global OFFSET_T* pg,
+                                OFFSET_T num_blocks)
+{
+    __local OFFSET_T tot[RADIX];
+    uint d = get_local_id(0);
+    OFFSET_T sum = 0;
+    for (OFFSET_T b = 0; b < num_blocks; ++b) {
+        OFFSET_T v = bs[b * RADIX + d];
+        bs[b * RADIX + d] = sum;
+        sum += v;
+    }
+    tot[d] = sum;
+    barrier(CLK_LOCAL_MEM_FENCE);
+    for (uint off = 1; off < RADIX; off <<= 1) {
+        OFFSET_T v = d >= off ? tot[d - off] : 0;
+        barrier(CLK_LOCAL_MEM_FENCE);
+        tot[d] += v;
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+    pg[d] = tot[d] - sum;
+}
+
+// One work-group per block: exclusive scan over the block's groups, seeded
+// with the block offset from scan_digit_blocks
+__kernel void scan_group_offsets(__global const OFFSET_T* gh,
+                                 __global const OFFSET_T* bs,
+                                 __global OFFSET_T*       go,
+                                 OFFSET_T num_groups)
+{
+    uint d = get_local_id(0);
+    OFFSET_T b = get_group_id(0);
+    OFFSET_T g1 = min(b * SCAN_BLOCK + SCAN_BLOCK, num_groups);
+    OFFSET_T sum = bs[b * RADIX + d];
+    for (OFFSET_T g = b * SCAN_BLOCK; g < g1; ++g) {
+        go[g * RADIX + d] = sum;
+        sum += gh[g * RADIX + d];
+    }
+}
+
+// Rank of this work-item's digit d among the group's earlier items with the
+// same digit (d == RADIX for items past the end). All work-items must call it.
+uint stable_rank(__local uint* digit, uint lid, uint d)
+{
+    digit[lid] = d;
+    barrier(CLK_LOCAL_MEM_FENCE);
+    uint rank = 0;
+    for (uint j = 0; j < lid; ++j) rank += digit[j] == d;
+    return rank;
+}
+
+// Position of this row's key with digit d among the tile's keys with that
+// digit: its rank in the row plus the keys placed by earlier rows (run),
+// which it then advances. All work-items must call it, once per row.
+uint tile_rank(__local uint* digit, __local uint* run, uint lid, uint d)
+{
+    uint rank = stable_rank(digit, lid, d);
+    if (d < RADIX) rank += run[d];
+    barrier(CLK_LOCAL_MEM_FENCE);
+    if (d < RADIX) atomic_inc(&run[d]);
+    barrier(CLK_LOCAL_MEM_FENCE);
+    return rank;
+}
+
+__kernel void scatter_stable(__global const ulong* in,
+                             __global ulong*       out,
+                             __global const OFFSET_T* pg,
+                             __global const OFFSET_T* go,
+                             OFFSET_T N, uint shift)
+{
+    __local uint digit[LOCAL_SZ];
+    __local uint run[RADIX];
+    uint lid = get_local_id(0);
+    OFFSET_T grp = get_group_id(0);
+    for (uint d = lid; d < RADIX; d += LOCAL_SZ) run[d] = 0;
+    for (uint r = 0; r < ROWS; ++r) {
+        OFFSET_T i = grp * SCATTER_TILE + r * LOCAL_SZ + lid;
+        ulong key = 0;
+        uint d = RADIX;  // out-of-range items match no digit
+        if (i < N) {
+            key = in[i];
+            d = (key >> shift) & (RADIX - 1);
+        }
+        uint rank = tile_rank(digit, run, lid, d);
+        if (i < N) out[pg[d] + go[grp * RADIX + d] + rank] = key;
+    }
+}
+
+// Key-value variants: the payload moves with its key. The histogram only
+// reads keys, so build_group_histogram serves all three.
+__kernel void scatter_stable_kv32(__global const ulong* in,
+                                  __global ulong*       out,
+                                  __global const uint*  vin,
+                                  __global uint*        vout,
+                                  __global const OFFSET_T* pg,
+                                  __global const OFFSET_T* go,
+                                  OFFSET_T N, uint shift)
+{
+    __local uint digit[LOCAL_SZ];
+    __local uint run[RADIX];
+    uint lid = get_local_id(0);
+    OFFSET_T grp = get_group_id(0);
+    for (uint d = lid; d < RADIX; d += LOCAL_SZ) run[d] = 0;
+    for (uint r = 0; r < ROWS; ++r) {
+        OFFSET_T i = grp * SCATTER_TILE + r * LOCAL_SZ + lid;
+        ulong key = 0;
+        uint d = RADIX;
+        if (i < N) {
+            key = in[i];
+            d = (key >> shift) & (RADIX - 1);
+        }
+        uint rank = tile_rank(digit, run, lid, d);
+        if (i < N) {
+            OFFSET_T dst = pg[d] + go[grp * RADIX + d] + rank;
+            out[dst] = key;
+            vout[dst] = vin[i];
+        }
+    }
+}
+
+__kernel void scatter_stable_kv64(__global const ulong* in,
+                                  __global ulong*       out,
+                                  __global const ulong* vin,
+                                  __global ulong*       vout,
+                                  __global const OFFSET_T* pg,
+                                  __global const OFFSET_T* go,
+                                  OFFSET_T N, uint shift)
+{
+    __local uint digit[LOCAL_SZ];
+    __local uint run[RADIX];
+    uint lid = get_local_id(0);
+    OFFSET_T grp = get_group_id(0);
+    for (uint d = lid; d < RADIX; d += LOCAL_SZ) run[d] = 0;
+    for (uint r = 0; r < ROWS; ++r) {
+        OFFSET_T i = grp * SCATTER_TILE + r * LOCAL_SZ + lid;
+        ulong key = 0;
+        uint d = RADIX;
+        if (i < N) {
+            key = in[i];
+            d = (key >> shift) & (RADIX - 1);
+        }
+        uint rank = tile_rank(digit, run, lid, d);
+        if (i < N) {
+            OFFSET_T dst = pg[d] + go[grp * RADIX + d] + rank;
+            out[dst] = key;
+            vout[dst] = vin[i];
+        }
+    }
+}
+
+// Sorts the tile by digit in local memory with one stable split per digit
+// bit (work-item lid owns slots lid*ROWS .. lid*ROWS+ROWS-1), then writes it
+// out in sorted order: consecutive work-items store consecutive keys of the
+// same digit run to consecutive addresses. Local memory: 16 * SCATTER_TILE
+// bytes of keys plus the scan and digit starts.
+__kernel void scatter_local(__global const ulong* in,
+                            __global ulong*       out,
+                            __global const OFFSET_T* pg,
+                            __global const OFFSET_T* go,
+                            OFFSET_T N, uint shift)
+{
+    __local ulong tile[2][SCATTER_TILE];
+    __local uint ones_before[LOCAL_SZ];
+    __local uint start[RADIX];
+    uint lid = get_local_id(0);
+    OFFSET_T grp = get_group_id(0), base = grp * SCATTER_TILE;
+    uint count = min((OFFSET_T)SCATTER_TILE, N - base);
+    for (uint j = lid; j < count; j += LOCAL_SZ) tile[0][j] = in[base + j];
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    uint src = 0;
+    for (uint b = shift; b < shift + BITS && b < 64; ++b) {
+        uint first = lid * ROWS, ones = 0;
+        for (uint r = 0; r < ROWS; ++r)
+            if (first + r < count) ones += (tile[src][first + r] >> b) & 1;
+        ones_before[lid] = ones;
+        barrier(CLK_LOCAL_MEM_FENCE);
+        for (uint off = 1; off < LOCAL_SZ; off <<= 1) {
+            uint v = lid >= off ? ones_before[lid - off] : 0;
+            barrier(CLK_LOCAL_MEM_FENCE);
+            ones_before[lid] += v;
+            barrier(CLK_LOCAL_MEM_FENCE);
+        }
+        uint one_at = count - ones_before[LOCAL_SZ - 1] + ones_before[lid] - ones;  // zeros go first
+        uint zero_at = first - (ones_before[lid] - ones);
+        for (uint r = 0; r < ROWS; ++r) {
+            if (first + r >= count) break;
+            ulong key = tile[src][first + r];
+            if ((key >> b) & 1) tile[1 - src][one_at++] = key;
+            else tile[1 - src][zero_at++] = key;
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);
+        src = 1 - src;
+    }
+
+    for (uint j = lid; j < count; j += LOCAL_SZ) {
+        uint d = (tile[src][j] >> shift) & (RADIX - 1);
+        if (j == 0 || ((tile[src][j - 1] >> shift) & (RADIX - 1)) != d) start[d] = j;
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+    for (uint j = lid; j < count; j += LOCAL_SZ) {
+        ulong key = tile[src][j];
+        uint d = (key >> shift) & (RADIX - 1);
+        out[pg[d] + go[grp * RADIX + d] + j - start[d]] = key;
+    }
+}
+
+// Segmented sort support: ids[i] = s for offsets[s] <= i < offsets[s + 1].
+// A stable sort by key carrying ids, then by id carrying keys, sorts every
+// segment in place with one launch sequence for all segments.
+__kernel void segment_ids(__global const OFFSET_T* offsets,
+                          __global ulong*          ids,
+                          OFFSET_T num_segments, OFFSET_T N)
+{
+    OFFSET_T gid = get_global_id(0);
+    if (gid >= N) return;
+    OFFSET_T lo = 0, hi = num_segments;  // last s with offsets[s] <= gid
+    while (hi - lo > 1) {
+        OFFSET_T mid = (lo + hi) / 2;
+        if (offsets[mid] <= gid) lo = mid;
+        else hi = mid;
+    }
+    ids[gid] = lo;
+}
+
+// ---------------------------------------------------------------------------
+// Onesweep pipeline: one histogram of every pass's digits up front, then a
+// single scatter launch per pass that finds its tile's offsets by decoupled
+// look-back over the preceding tiles instead of a separate histogram and scan.
+// Per pass each key is read once and written once.
+//   sweep[p*RADIX + d]       count, then exclusive offset, of digit d in pass p
+//   sweep[PASSES*RADIX + p]  tile counter of pass p (dynamic tile ids)
+// A tile is ITEMS keys per work-item. status[t*RADIX + d] holds tile t's
+// digit-d count with a flag in the top two bits: 0 not yet published,
+// AGGREGATE the tile's own count, INCLUSIVE the count of tiles 0..t. Counts
+// are 30 bits, so a sort is limited to 2^30 keys. Passes alternate between
+// two status buffers; each pass clears the one the next pass uses, and
+// global_histogram clears the first.
+
+#ifndef ITEMS
+#define ITEMS 4
+#endif
+#define PASSES ((64 + BITS - 1) / BITS)
+#define TILE (LOCAL_SZ * ITEMS)
+#define FLAG_AGGREGATE 0x40000000u
+#define FLAG_INCLUSIVE 0x80000000u
+#define VALUE_MASK     0x3fffffffu
+
+// Grid-stride over all keys: every digit of every pass in one read
+__kernel void global_histogram(__global const ulong* in,
+                               __global uint*        sweep,
+                               __global uint*        status,
+                               uint N, uint status_len)
+{
+    __local uint hist[PASSES * RADIX];
+    uint lid = get_local_id(0), gid = get_global_id(0), gsz = get_global_size(0);
+    for (uint i = lid; i < PASSES * RADIX; i += LOCAL_SZ) hist[i] = 0;
+    for (uint i = gid; i < status_len; i += gsz) status[i] = 0;
+    barrier(CLK_LOCAL_MEM_FENCE);
+    for (uint i = gid; i < N; i += gsz) {
+        ulong key = in[i];
+        for (uint p = 0; p < PASSES; ++p)
+            atomic_inc(&hist[p * RADIX + ((key >> (p * BITS)) & (RADIX - 1))]);
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+    for (uint i = lid; i < PASSES * RADIX; i += LOCAL_SZ)
+        if (hist[i]) atomic_add(&sweep[i], hist[i]);
+}
+
+// One work-group of RADIX items per pass: counts to exclusive offsets in place
+__kernel void scan_pass_digits(__global uint* sweep)
+{
+    __local uint tot[RADIX];
+    uint d = get_local_id(0), p = get_group_id(0);
+    uint count = sweep[p * RADIX + d];
+    tot[d] = count;
+    barrier(CLK_LOCAL_MEM_FENCE);
+    for (uint off = 1; off < RADIX; off <<= 1) {
+        uint v = d >= off ? tot[d - off] : 0;
+        barrier(CLK_LOCAL_MEM_FENCE);
+        tot[d] += v;
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+    sweep[p * RADIX + d] = tot[d] - count;
+}
+
+__kernel void onesweep_scatter(__global const ulong* in,
+                               __global ulong*       out,
+                               __global uint*        sweep,
+                               __global uint*        status,
+                               __global uint*        next_status,
+                               uint N, uint pass)
+{
+    __local uint tile_id;
+    __local uint hist[RADIX];   // tile's digit counts, then running count per digit
+    __local uint base[RADIX];   // global position of the tile's first key per digit
+    __local uint digit[LOCAL_SZ];
+    uint lid = get_local_id(0);
+    uint shift = pass * BITS;
+
+    // Tiles are numbered in the order work-groups start, so every tile this
+    // one waits on is already running
+    if (lid == 0) tile_id = atomic_inc(&sweep[PASSES * RADIX + pass]);
+    for (uint d = lid; d < RADIX; d += LOCAL_SZ) hist[d] = 0;
+    barrier(CLK_LOCAL_MEM_FENCE);
+    uint tile = tile_id;
+    for (uint d = lid; d < RADIX; d += LOCAL_SZ) next_status[tile * RADIX + d] = 0;
+
+    ulong key[ITEMS];
+    uint kd[ITEMS];
+    for (uint r = 0; r < ITEMS; ++r) {
+        uint i = tile * TILE + r * LOCAL_SZ + lid;
+        kd[r] = RADIX;  // out-of-range items match no digit
+        if (i < N) {
+            key[r] = in[i];
+            kd[r] = (key[r] >> shift) & (RADIX - 1);
+            atomic_inc(&hist[kd[r]]);
+        }
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    // Publish this tile's counts, then walk back until an inclusive prefix
+    for (uint d = lid; d < RADIX; d += LOCAL_SZ) {
+        uint count = hist[d];
+        __global uint* own = &status[tile * RADIX + d];
+        atomic_xchg(own, (tile == 0 ? FLAG_INCLUSIVE : FLAG_AGGREGATE) | count);
+        uint excl = 0;
+        for (int t = (int)tile - 1; t >= 0;) {
+            uint s = atomic_or(&status[t * RADIX + d], 0u);
+            if (!(s & (FLAG_AGGREGATE | FLAG_INCLUSIVE))) continue;  // predecessor not published yet
+            excl += s & VALUE_MASK;
+            if (s & FLAG_INCLUSIVE) break;
+            --t;
+        }
+        if (tile > 0) atomic_xchg(own, FLAG_INCLUSIVE | (excl + count));
+        base[d] = sweep[pass * RADIX + d] + excl;
+        hist[d] = 0;
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    // Stable placement, one row of LOCAL_SZ keys at a time: rank within the
+    // row plus the keys of that digit in earlier rows
+    for (uint r = 0; r < ITEMS; ++r) {
+        uint d = kd[r];
+        digit[lid] = d;
+        barrier(CLK_LOCAL_MEM_FENCE);
+        if (d < RADIX) {
+            uint rank = 0;
+            for (uint j = 0; j < lid; ++j) rank += digit[j] == d;
+            out[base[d] + hist[d] + rank] = key[r];
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);
+        if (d < RADIX) atomic_inc(&hist[d]);
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+}
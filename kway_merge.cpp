@@ -0,0 +1,25 @@
+#include "kway_merge.hpp"
+#include <cstdint>
+#include <functional>
+#include <queue>
+
+// Heap-based K-way merge: O(N log k) comparisons, one sequential read stream
+// per run and one sequential write stream.
+template <typename T>
+void kway_merge(const std::vector<std::pair<const T*, size_t>>& runs, T* out) {
+    typedef std::pair<T, size_t> Head; // current key, run index
+    std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heap;
+    std::vector<size_t> pos(runs.size(), 0);
+    for (size_t r = 0; r < runs.size(); ++r)
+        if (runs[r].second > 0) heap.push({runs[r].first[0], r});
+
+    while (!heap.empty()) {
+        size_t r = heap.top().second;
+        *out++ = heap.top().first;
+        heap.pop();
+        if (++pos[r] < runs[r].second) heap.push({runs[r].first[pos[r]], r});
+    }
+}
+
+// Explicit instantiations for uint64_t
+template void kway_merge<uint64_t>(const std::vector<std::pair<const uint64_t*, size_t>>&, uint64_t*);
@@ -0,0 +1,9 @@
+#pragma once
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// K-way merge of sorted runs into out (out must hold the sum of run lengths).
+// Each run is given as {pointer, length}.
+template <typename T>
+void kway_merge(const std::vector<std::pair<const T*, size_t>>& runs, T* out);
@@ -0,0 +1,142 @@
+#include "local_object_store.hpp"
+#include "util.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+static void sleep_until_sec(double t) {
+    double d = t - now_sec();
+    if (d > 0) std::this_thread::sleep_for(std::chrono::duration<double>(d));
+}
+
+LocalObjectStore::LocalObjectStore(const std::string& root, const StoreShaping& shaping, uint64_t seed)
+    : root_(root), shaping_(shaping), rng_(seed),
+      tokens_(std::max(1.0, shaping.max_requests_per_sec)), last_refill_(now_sec()), link_free_at_(0) {
+    fs::create_directories(root_);
+}
+
+std::string LocalObjectStore::path(const std::string& key) const {
+    return root_ + "/" + key;
+}
+
+void LocalObjectStore::request(size_t bytes, Op op) {
+    double MB = bytes / (1024.0 * 1024.0);
+
+    // request-rate budget: token bucket refilled at max_requests_per_sec, burst of
+    // one second (but at least one request, so budgets below 1/s still admit)
+    for (;;) {
+        std::unique_lock<std::mutex> lk(mu_);
+        if (shaping_.max_requests_per_sec <= 0) break;
+        double now = now_sec();
+        tokens_ = std::min(std::max(1.0, shaping_.max_requests_per_sec),
+                           tokens_ + (now - last_refill_) * shaping_.max_requests_per_sec);
+        last_refill_ = now;
+        if (tokens_ >= 1) { tokens_ -= 1; break; }
+        ++stats_.throttled;
+        lk.unlock();
+        std::this_thread::sleep_for(std::chrono::duration<double>(shaping_.throttle_backoff_ms / 1000.0));
+    }
+
+    double start = now_sec();
+    double done = start + shaping_.latency_ms / 1000.0;
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        if (shaping_.mean_throughput_MBps > 0) {
+            std::normal_distribution<double> d(shaping_.mean_throughput_MBps,
+                                               shaping_.mean_throughput_MBps * shaping_.throughput_jitter);
+            done += MB / std::max(1.0, d(rng_));
+        }
+        if (shaping_.aggregate_MBps > 0) {
+            link_free_at_ = std::max(link_free_at_, start) + MB / shaping_.aggregate_MBps;
+            done = std::max(done, link_free_at_);
+        }
+        if (op == Op::Put) {
+            stats_.put_requests += 1;
+            stats_.bytes_written += bytes;
+        } else {
+            (op == Op::Get ? stats_.get_requests : stats_.head_requests) += 1;
+            stats_.bytes_read += bytes;
+        }
+        stats_.cost += MB * shaping_.cost_per_GB / 1024.0 + shaping_.cost_per_request;
+    }
+    sleep_until_sec(done);
+}
+
+void LocalObjectStore::write_chunks(const std::string& key, const char* data, size_t size, bool truncate) {
+    fs::path p = path(key);
+    fs::create_directories(p.parent_path());
+    std::ofstream f(p, std::ios::binary | (truncate ? std::ios::trunc : std::ios::app));
+    if (!f) throw std::runtime_error("LocalObjectStore: cannot write " + key);
+    size_t chunk = std::max<size_t>(1, size_t(shaping_.chunk_size_MB * 1024 * 1024));
+    size_t off = 0;
+    do {
+        size_t n = std::min(chunk, size - off);
+        request(n, Op::Put);
+        if (!f.write(data + off, n)) throw std::runtime_error("LocalObjectStore: write failed for " + key);
+        off += n;
+    } while (off < size);
+    if (!f.flush()) throw std::runtime_error("LocalObjectStore: write failed for " + key);
+}
+
+void LocalObjectStore::put(const std::string& key, const void* data, size_t size) {
+    write_chunks(key, static_cast<const char*>(data), size, true);
+}
+
+void LocalObjectStore::append(const std::string& key, const void* data, size_t size) {
+    write_chunks(key, static_cast<const char*>(data), size, false);
+}
+
+size_t LocalObjectStore::object_size(const std::string& key) const {
+    std::error_code ec;
+    auto sz = fs::file_size(path(key), ec);
+    if (ec) throw std::runtime_error("LocalObjectStore: no such key " + key);
+    return sz;
+}
+
+size_t LocalObjectStore::size(const std::string& key) {
+    request(0, Op::Head);
+    return object_size(key);
+}
+
+size_t LocalObjectStore::get_range(const std::string& key, size_t offset, size_t len, void* dst) {
+    size_t total = object_size(key);
+    if (offset >= total) return 0;
+    len = std::min(len, total - offset);
+    std::ifstream f(path(key), std::ios::binary);
+    if (!f.seekg(offset)) throw std::runtime_error("LocalObjectStore: cannot read " + key);
+    size_t chunk = std::max<size_t>(1, size_t(shaping_.chunk_size_MB * 1024 * 1024));
+    char* out = static_cast<char*>(dst);
+    for (size_t done = 0; done < len;) {
+        size_t n = std::min(chunk, len - done);
+        request(n, Op::Get);
+        if (!f.read(out + done, n)) throw std::runtime_error("LocalObjectStore: short read from " + key);
+        done += n;
+    }
+    return len;
+}
+
+std::vector<char> LocalObjectStore::get(const std::string& key) {
+    std::vector<char> buf(object_size(key));
+    get_range(key, 0, buf.size(), buf.data());
+    return buf;
+}
+
+void LocalObjectStore::remove(const std::string& key) {
+    fs::remove(path(key));
+}
+
+StoreStats LocalObjectStore::stats() {
+    std::lock_guard<std::mutex> lk(mu_);
+    return stats_;
+}
+
+void LocalObjectStore::reset_stats() {
+    std::lock_guard<std::mutex> lk(mu_);
+    stats_ = StoreStats();
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+// Filesystem-backed, in-process stand-in for an S3-like object store.
+// Every request is delayed the way external_sort_sim's ObjectStore models it:
+// each object access is split into chunk_size_MB requests, and each request
+// costs latency_ms plus chunk/throughput with throughput drawn per request
+// from N(mean, mean*jitter). On top of that the bucket enforces an optional
+// request-rate budget (throttled requests back off and retry) and an optional
+// aggregate bandwidth cap shared by all concurrent streams.
+
+struct StoreShaping {
+    double latency_ms = 0;            // base latency per request
+    double mean_throughput_MBps = 0;  // nominal per-stream throughput (0 = unshaped)
+    double throughput_jitter = 0;     // fractional jitter of per-request throughput
+    double cost_per_GB = 0;           // cost per GB transferred
+    double cost_per_request = 0;      // fixed cost per API call
+    double chunk_size_MB = 64;        // request granularity
+    double max_requests_per_sec = 0;  // bucket request budget (0 = unlimited)
+    double throttle_backoff_ms = 100; // wait before retrying a throttled request
+    double aggregate_MBps = 0;        // bandwidth cap across all streams (0 = unlimited)
+};
+
+struct StoreStats {
+    uint64_t get_requests = 0;
+    uint64_t put_requests = 0;
+    uint64_t head_requests = 0;       // size lookups, billed like a GET
+    uint64_t bytes_read = 0;
+    uint64_t bytes_written = 0;
+    uint64_t throttled = 0;           // requests rejected by the rate budget and retried
+    double cost = 0;
+
+    uint64_t requests() const { return get_requests + put_requests + head_requests; }
+    StoreStats operator-(const StoreStats& o) const {
+        return {get_requests - o.get_requests, put_requests - o.put_requests, head_requests - o.head_requests,
+                bytes_read - o.bytes_read, bytes_written - o.bytes_written,
+                throttled - o.throttled, cost - o.cost};
+    }
+};
+
+class LocalObjectStore {
+public:
+    LocalObjectStore(const std::string& root, const StoreShaping& shaping, uint64_t seed = 42);
+
+    // PUT: create or replace an object
+    void put(const std::string& key, const void* data, size_t size);
+    // Upload one more part of a multipart object (one PUT per chunk, like UploadPart)
+    void append(const std::string& key, const void* data, size_t size);
+    // GET: whole object
+    std::vector<char> get(const std::string& key);
+    // Ranged GET: bytes [offset, offset+len) into dst; returns bytes read
+    size_t get_range(const std::string& key, size_t offset, size_t len, void* dst);
+    // HEAD: object size (throws if missing)
+    size_t size(const std::string& key);
+    void remove(const std::string& key);
+
+    const StoreShaping& shaping() const { return shaping_; }
+    StoreStats stats();
+    void reset_stats();
+
+private:
+    enum class Op { Get, Put, Head };
+
+    std::string path(const std::string& key) const;
+    size_t object_size(const std::string& key) const;  // no request
+    void write_chunks(const std::string& key, const char* data, size_t size, bool truncate);
+    // Delay the calling thread for one request of `bytes` and account it
+    void request(size_t bytes, Op op);
+
+    std::string root_;
+    StoreShaping shaping_;
+    std::mutex mu_;
+    std::mt19937_64 rng_;
+    StoreStats stats_;
+    double tokens_;          // request-rate token bucket
+    double last_refill_;
+    double link_free_at_;    // when the shared bandwidth cap is next idle
+};
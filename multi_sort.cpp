@@ -0,0 +1,142 @@
+#include "multi_sort.hpp"
+#include "util.hpp"
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+static const unsigned RANGE_BITS = 16;   // MSD histogram granularity
+static const double MIN_SHARE = 0.01;    // every device keeps enough work to be measured
+
+MultiSorter::MultiSorter(const MultiSortConfig& cfg) : cfg_(cfg) {
+    std::vector<size_t> ids = cfg_.devices;
+    if (ids.empty())
+        for (size_t i = 0, n = opencl_devices().size(); i < n; ++i) ids.push_back(i);
+    if (ids.empty()) throw std::runtime_error("no OpenCL device");
+    for (size_t id : ids) {
+        OpenCLSortConfig c = cfg_.device;
+        c.device = id;
+        sorters_.push_back(std::make_unique<OpenCLSorter>(c));
+    }
+    share_.assign(sorters_.size(), 1.0 / sorters_.size());
+    threads_ = cfg_.threads ? cfg_.threads : std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Writes in[0..n) to out as one key range per device, in device order, and
+// sets begin[d] to the start of range d (begin[devices] = n). All keys share
+// the bits above the highest bit in which the smallest and largest differ,
+// so the histogram covers the RANGE_BITS bits below that: narrow key ranges
+// split as evenly as wide ones, and only a single bucket holding more than a
+// device's share can unbalance the ranges.
+void MultiSorter::partition(const uint64_t* in, uint64_t* out, size_t n, std::vector<size_t>& begin) {
+    const size_t BUCKETS = size_t(1) << RANGE_BITS;
+    const size_t devices = sorters_.size();
+    const size_t threads = threads_;
+    std::vector<size_t> slice(threads + 1);
+    for (size_t t = 0; t <= threads; ++t) slice[t] = n * t / threads;
+
+    std::vector<uint64_t> lo(threads, UINT64_MAX), hi(threads, 0);
+    parallel(threads, [&](size_t t) {
+        for (size_t i = slice[t]; i < slice[t + 1]; ++i) {
+            lo[t] = std::min(lo[t], in[i]);
+            hi[t] = std::max(hi[t], in[i]);
+        }
+    });
+    uint64_t diff = *std::min_element(lo.begin(), lo.end()) ^ *std::max_element(hi.begin(), hi.end());
+    unsigned width = 0;
+    while (width < 64 && (diff >> width)) ++width;
+    const unsigned SHIFT = width > RANGE_BITS ? width - RANGE_BITS : 0;
+
+    std::vector<std::vector<size_t>> hist(threads, std::vector<size_t>(BUCKETS));
+    parallel(threads, [&](size_t t) {
+        for (size_t i = slice[t]; i < slice[t + 1]; ++i) ++hist[t][(in[i] >> SHIFT) & (BUCKETS - 1)];
+    });
+    std::vector<size_t> below(BUCKETS + 1);  // keys in buckets before b
+    for (size_t b = 0; b < BUCKETS; ++b) {
+        below[b + 1] = below[b];
+        for (size_t t = 0; t < threads; ++t) below[b + 1] += hist[t][b];
+    }
+
+    // Range d covers buckets cut[d]..cut[d+1]: each cut is the bucket
+    // boundary closest to the keys the shares so far ask for
+    std::vector<size_t> cut(devices + 1, 0), range_of(BUCKETS);
+    cut[devices] = BUCKETS;
+    double want = 0;
+    for (size_t d = 1; d < devices; ++d) {
+        want += share_[d - 1] * n;
+        size_t b = std::lower_bound(below.begin(), below.end(), size_t(want + 0.5)) - below.begin();
+        if (b > 0 && want - below[b - 1] < below[b] - want) --b;
+        cut[d] = std::max(cut[d - 1], std::min(b, BUCKETS));
+    }
+    begin.assign(devices + 1, 0);
+    for (size_t d = 0; d <= devices; ++d) begin[d] = below[cut[d]];
+    for (size_t d = 0; d < devices; ++d)
+        for (size_t b = cut[d]; b < cut[d + 1]; ++b) range_of[b] = d;
+
+    // each thread writes its keys of range d after those of earlier threads
+    std::vector<std::vector<size_t>> pos(threads, std::vector<size_t>(devices));
+    for (size_t d = 0; d < devices; ++d)
+        for (size_t t = 0, at = begin[d]; t < threads; ++t) {
+            pos[t][d] = at;
+            for (size_t b = cut[d]; b < cut[d + 1]; ++b) at += hist[t][b];
+        }
+    parallel(threads, [&](size_t t) {
+        for (size_t i = slice[t]; i < slice[t + 1]; ++i)
+            out[pos[t][range_of[(in[i] >> SHIFT) & (BUCKETS - 1)]]++] = in[i];
+    });
+}
+
+void MultiSorter::sort(uint64_t* data, size_t n) {
+    const size_t devices = sorters_.size();
+    last_ = MultiSortStats();
+    last_.keys.assign(devices, 0);
+    last_.sec.assign(devices, 0);
+    if (n == 0) return;
+    if (devices == 1) {
+        double t = now_sec();
+        sorters_[0]->sort(data, n);
+        last_.keys[0] = n;
+        last_.sec[0] = now_sec() - t;
+        return;
+    }
+    if (scratch_.size() < n) scratch_.resize(n);
+    uint64_t* scratch = scratch_.data();
+
+    // ranges go to scratch and every device sorts its own back into data
+    double t0 = now_sec();
+    std::vector<size_t> begin;
+    partition(data, scratch, n, begin);
+    last_.partition_sec = now_sec() - t0;
+
+    std::vector<std::exception_ptr> errors(devices);
+    parallel(devices, [&](size_t d) {
+        double t = now_sec();
+        size_t len = begin[d + 1] - begin[d];
+        try {
+            if (len > 0) sorters_[d]->sort_chunked(scratch + begin[d], data + begin[d], len);
+        } catch (...) {
+            errors[d] = std::current_exception();
+        }
+        last_.keys[d] = len;
+        last_.sec[d] = now_sec() - t;
+    });
+    for (auto& e : errors)
+        if (e) std::rethrow_exception(e);
+
+    // Next ranges: each device's share of the combined keys-per-second, once
+    // every device has been measured
+    std::vector<double> rate(devices);
+    double total = 0;
+    for (size_t d = 0; d < devices; ++d) {
+        if (last_.keys[d] == 0 || last_.sec[d] <= 0) return;
+        rate[d] = last_.keys[d] / last_.sec[d];
+        total += rate[d];
+    }
+    double sum = 0;
+    for (size_t d = 0; d < devices; ++d) {
+        share_[d] = std::max(MIN_SHARE, (1 - cfg_.smoothing) * share_[d] + cfg_.smoothing * rate[d] / total);
+        sum += share_[d];
+    }
+    for (auto& s : share_) s /= sum;
+}
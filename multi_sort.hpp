@@ -0,0 +1,50 @@
+#pragma once
+#include "opencl_sort.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Sort across several OpenCL devices at once. The input is MSD range
+// partitioned: a histogram of the 16 bits below the prefix all keys share
+// places one bucket boundary per device, the keys are scattered so that
+// device i holds the i-th key range, and every device sorts its range on its
+// own thread. The sorted ranges concatenate, so nothing is merged. The ranges
+// follow the measured throughput of each device.
+
+struct MultiSortConfig {
+    OpenCLSortConfig device;                 // settings for every device; its device index is ignored
+    std::vector<size_t> devices;             // indices into opencl_devices(); empty: all of them
+    size_t threads = 0;                      // host threads for the histogram and scatter; 0: hardware threads
+    double smoothing = 0.5;                  // weight of the latest call when updating the shares
+};
+
+// What the last call did, per device in the order of MultiSorter::device()
+struct MultiSortStats {
+    std::vector<size_t> keys;
+    std::vector<double> sec;                 // wall time of each device, running concurrently
+    double partition_sec = 0;                // prefix, histogram and scatter
+};
+
+class MultiSorter {
+public:
+    explicit MultiSorter(const MultiSortConfig& cfg = MultiSortConfig());
+
+    // Sorts data[0..n) in place
+    void sort(uint64_t* data, size_t n);
+
+    size_t devices() const { return sorters_.size(); }
+    OpenCLSorter& device(size_t i) { return *sorters_[i]; }
+    const std::vector<double>& shares() const { return share_; }  // used by the next call
+    const MultiSortStats& last() const { return last_; }
+
+private:
+    void partition(const uint64_t* in, uint64_t* out, size_t n, std::vector<size_t>& begin);
+
+    MultiSortConfig cfg_;
+    std::vector<std::unique_ptr<OpenCLSorter>> sorters_;
+    size_t threads_;
+    std::vector<double> share_;
+    MultiSortStats last_;
+    std::vector<uint64_t> scratch_;
+};
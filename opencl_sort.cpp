@@ -1,171 +1,1099 @@
-#define CL_TARGET_OPENCL_VERSION 300
-#include <CL/cl.h>
+#include "opencl_sort.hpp"
+#include "kway_merge.hpp"
 #include <vector>
 #include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <limits>
 #include <random>
+#include <sstream>
 #include <iostream>
+#include <filesystem>
 #include <fstream>
-#include <cassert>
+#include <stdexcept>
+#include <string>
+#include <utility>
 
 // global counters for memory transfers
-static uint64_t total_host_to_device = 0;
-static uint64_t total_device_to_host = 0;
+std::atomic<uint64_t> total_host_to_device{0};
+std::atomic<uint64_t> total_device_to_host{0};
+
+static void check(cl_int err, const char* what) {
+    if (err != CL_SUCCESS)
+        throw std::runtime_error(std::string("OpenCL error ") + std::to_string(err) + " in " + what);
+}
 
 // wrappers that count bytes transferred
 #define ENQUEUE_WRITE(q, buf, block, off, sz, ptr, numEvents, eventList, event) \
     do { \
       total_host_to_device += (sz); \
-      cl_int __err = clEnqueueWriteBuffer((q),(buf),(block),(off),(sz),(ptr),(numEvents),(eventList),(event)); \
-      assert(__err == CL_SUCCESS); \
+      check(clEnqueueWriteBuffer((q),(buf),(block),(off),(sz),(ptr),(numEvents),(eventList),(event)), \
+            "clEnqueueWriteBuffer"); \
     } while(0)
 
 #define ENQUEUE_READ(q, buf, block, off, sz, ptr, numEvents, eventList, event) \
     do { \
       total_device_to_host += (sz); \
-      cl_int __err = clEnqueueReadBuffer((q),(buf),(block),(off),(sz),(ptr),(numEvents),(eventList),(event)); \
-      assert(__err == CL_SUCCESS); \
+      check(clEnqueueReadBuffer((q),(buf),(block),(off),(sz),(ptr),(numEvents),(eventList),(event)), \
+            "clEnqueueReadBuffer"); \
     } while(0)
 
-static std::string load(const char* path) {
-  std::ifstream f(path);
-  assert(f);
-  return { std::istreambuf_iterator<char>(f), {} };
+// kernels/radix_kernels.cl, embedded at build time as a raw string literal:
+//   (echo 'R"CLC('; cat kernels/radix_kernels.cl; echo ')CLC"') > radix_kernels.cl.inc
+static const char RADIX_KERNELS_SRC[] =
+#include "radix_kernels.cl.inc"
+;
+
+static uint64_t fnv1a(const std::string& s) {
+    uint64_t h = 1469598103934665603ull;
+    for (unsigned char c : s) { h ^= c; h *= 1099511628211ull; }
+    return h;
 }
 
-void run_opencl_radix(const std::vector<uint64_t>& in,
-                      std::vector<uint64_t>&       out,
-                      size_t N)
-{
-    const int    BITS      = 8;
-    const int    RADIX     = 1 << BITS;
-    const size_t LOCAL_SZ  = 256;
-    const size_t NUM_GROUPS= (N + LOCAL_SZ - 1) / LOCAL_SZ;
-    const size_t GLOBAL_SZ = NUM_GROUPS * LOCAL_SZ;
-    const int    PASSES    = (64 + BITS - 1) / BITS;
+static std::string device_string(cl_device_id d, cl_device_info what) {
+    size_t n = 0;
+    clGetDeviceInfo(d, what, 0, nullptr, &n);
+    std::string s(n, '\0');
+    clGetDeviceInfo(d, what, n, &s[0], nullptr);
+    while (!s.empty() && s.back() == '\0') s.pop_back();
+    return s;
+}
+
+static std::string build_log(cl_program prog, cl_device_id d) {
+    size_t n = 0;
+    clGetProgramBuildInfo(prog, d, CL_PROGRAM_BUILD_LOG, 0, nullptr, &n);
+    std::string log(n, '\0');
+    clGetProgramBuildInfo(prog, d, CL_PROGRAM_BUILD_LOG, n, &log[0], nullptr);
+    return log;
+}
+
+// Builds the embedded kernels for d. A binary cached by an earlier process for
+// the same device, driver version, build options and kernel source is loaded
+// instead of compiling; otherwise the source is compiled and its binary saved.
+static cl_program build_program(cl_context ctx, cl_device_id d, const std::string& opts,
+                                const std::string& cache_dir) {
+    std::string key = device_string(d, CL_DEVICE_NAME) + "|" + device_string(d, CL_DRIVER_VERSION) +
+                      "|" + opts + "|" + std::to_string(fnv1a(RADIX_KERNELS_SRC));
+    std::string path = cache_dir + "/radix_" + std::to_string(fnv1a(key)) + ".bin";
+    cl_int err;
+
+    std::ifstream f;
+    if (!cache_dir.empty()) f.open(path, std::ios::binary);
+    std::string stored_key;
+    if (f && std::getline(f, stored_key) && stored_key == key) {
+        std::string bin{ std::istreambuf_iterator<char>(f), {} };
+        const unsigned char* b = reinterpret_cast<const unsigned char*>(bin.data());
+        size_t len = bin.size();
+        cl_int status;
+        cl_program prog = clCreateProgramWithBinary(ctx, 1, &d, &len, &b, &status, &err);
+        if (err == CL_SUCCESS && status == CL_SUCCESS &&
+            clBuildProgram(prog, 1, &d, opts.c_str(), nullptr, nullptr) == CL_SUCCESS)
+            return prog;
+        if (prog) clReleaseProgram(prog);  // stale or rejected binary: rebuild from source
+    }
+
+    const char* s = RADIX_KERNELS_SRC;
+    cl_program prog = clCreateProgramWithSource(ctx, 1, &s, nullptr, &err);
+    check(err, "clCreateProgramWithSource");
+    err = clBuildProgram(prog, 1, &d, opts.c_str(), nullptr, nullptr);
+    if (err != CL_SUCCESS) {
+        std::string log = build_log(prog, d);
+        clReleaseProgram(prog);
+        throw std::runtime_error("OpenCL kernel build failed:\n" + log);
+    }
+    if (cache_dir.empty()) return prog;
 
-    // Copy input to CPU baseline and sort for later verify
-    std::vector<uint64_t> cpu = in;
-    std::sort(cpu.begin(), cpu.end());
-    out.resize(N);
+    size_t len = 0;
+    clGetProgramInfo(prog, CL_PROGRAM_BINARY_SIZES, sizeof(len), &len, nullptr);
+    std::string bin(len, '\0');
+    unsigned char* b = reinterpret_cast<unsigned char*>(&bin[0]);
+    if (len > 0 && clGetProgramInfo(prog, CL_PROGRAM_BINARIES, sizeof(b), &b, nullptr) == CL_SUCCESS) {
+        std::error_code ec;
+        std::filesystem::create_directories(cache_dir, ec);
+        std::string tmp = path + ".tmp";
+        std::ofstream o(tmp, std::ios::binary);
+        o << key << "\n" << bin;
+        o.close();
+        if (o) std::filesystem::rename(tmp, path, ec);  // atomic, so concurrent readers never see a partial file
+    }
+    return prog;
+}
+
+static cl_kernel create_kernel(cl_program prog, const char* name) {
+    cl_int err;
+    cl_kernel k = clCreateKernel(prog, name, &err);
+    check(err, name);
+    return k;
+}
 
-    // 1) OpenCL init (platform, device, ctx, queue)
-    cl_uint np; clGetPlatformIDs(0, nullptr, &np);
+static int type_rank(cl_device_type t) {
+    if (t & CL_DEVICE_TYPE_GPU) return 0;
+    if (t & CL_DEVICE_TYPE_ACCELERATOR) return 1;
+    if (t & CL_DEVICE_TYPE_CPU) return 2;
+    return 3;
+}
+
+std::vector<OpenCLDevice> opencl_devices() {
+    std::vector<OpenCLDevice> all;
+    cl_uint np = 0;
+    if (clGetPlatformIDs(0, nullptr, &np) != CL_SUCCESS || np == 0) return all;
     std::vector<cl_platform_id> ps(np);
     clGetPlatformIDs(np, ps.data(), nullptr);
-    cl_platform_id p = ps[0];
+    for (cl_platform_id p : ps) {
+        cl_uint nd = 0;
+        if (clGetDeviceIDs(p, CL_DEVICE_TYPE_ALL, 0, nullptr, &nd) != CL_SUCCESS || nd == 0) continue;
+        std::vector<cl_device_id> ds(nd);
+        clGetDeviceIDs(p, CL_DEVICE_TYPE_ALL, nd, ds.data(), nullptr);
+        for (cl_device_id d : ds) {
+            cl_device_type type = 0;
+            clGetDeviceInfo(d, CL_DEVICE_TYPE, sizeof(type), &type, nullptr);
+            all.push_back({p, d, type, device_string(d, CL_DEVICE_NAME)});
+        }
+    }
+    std::stable_sort(all.begin(), all.end(), [](const OpenCLDevice& a, const OpenCLDevice& b) {
+        return type_rank(a.type) < type_rank(b.type);
+    });
+    return all;
+}
+
+// Tuned settings live next to the program binaries, one text file per device
+// and driver: the key on the first line, then "name value" lines
+static std::string tuned_key(cl_device_id d) {
+    return device_string(d, CL_DEVICE_NAME) + "|" + device_string(d, CL_DRIVER_VERSION);
+}
 
-    cl_uint nd; clGetDeviceIDs(p, CL_DEVICE_TYPE_GPU, 0, nullptr, &nd);
-    std::vector<cl_device_id> ds(nd);
-    clGetDeviceIDs(p, CL_DEVICE_TYPE_GPU, nd, ds.data(), nullptr);
-    cl_device_id d = ds[0];
+static std::string tuned_path(cl_device_id d, const std::string& cache_dir) {
+    return cache_dir + "/tuned_" + std::to_string(fnv1a(tuned_key(d))) + ".txt";
+}
+
+// Applies the settings tune_opencl_sort saved for d; false if there are none
+static bool read_tuned(cl_device_id d, OpenCLSortConfig& cfg) {
+    if (cfg.cache_dir.empty()) return false;
+    std::ifstream f(tuned_path(d, cfg.cache_dir));
+    std::string key, line;
+    if (!f || !std::getline(f, key) || key != tuned_key(d)) return false;
+    while (std::getline(f, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream ss(line);
+        std::string name, value;
+        if (!(ss >> name >> value)) continue;
+        size_t v = std::strtoull(value.c_str(), nullptr, 10);
+        if (name == "bits") cfg.bits = int(v);
+        else if (name == "local_size") cfg.local_size = v;
+        else if (name == "items") cfg.items = v;
+        else if (name == "scatter_tile") cfg.scatter_tile = v;
+        else if (name == "local_scatter") cfg.local_scatter = v != 0;
+        else if (name == "pipeline") cfg.pipeline = value == "onesweep" ? Pipeline::Onesweep : Pipeline::Classic;
+    }
+    return true;
+}
+
+static void write_tuned(cl_device_id d, const OpenCLSortConfig& cfg) {
+    std::error_code ec;
+    std::filesystem::create_directories(cfg.cache_dir, ec);
+    std::string path = tuned_path(d, cfg.cache_dir), tmp = path + ".tmp";
+    std::ofstream o(tmp);
+    o << tuned_key(d) << "\n"
+      << "# written by tune_opencl_sort\n"
+      << "pipeline " << (cfg.pipeline == Pipeline::Onesweep ? "onesweep" : "classic") << "\n"
+      << "bits " << cfg.bits << "\n"
+      << "local_size " << cfg.local_size << "\n"
+      << "items " << cfg.items << "\n"
+      << "scatter_tile " << cfg.scatter_tile << "\n"
+      << "local_scatter " << cfg.local_scatter << "\n";
+    o.close();
+    if (!o) throw std::runtime_error("tune_opencl_sort: cannot write " + tmp);
+    std::filesystem::rename(tmp, path, ec);
+    if (ec) throw std::runtime_error("tune_opencl_sort: cannot write " + path);
+}
 
+OpenCLSorter::OpenCLSorter(const OpenCLSortConfig& cfg) : cfg_(cfg) {
+    try {
+        std::vector<OpenCLDevice> devices = opencl_devices();
+        if (devices.empty()) throw std::runtime_error("no OpenCL device");
+        if (cfg_.device >= devices.size())
+            throw std::invalid_argument("OpenCLSorter: device " + std::to_string(cfg_.device) + " of " +
+                                        std::to_string(devices.size()));
+        device_ = devices[cfg_.device].id;
+        cl_platform_id platform = devices[cfg_.device].platform;
+        if (cfg_.use_tuned) tuned_ = read_tuned(device_, cfg_);
+        if (tile_keys() % cfg_.local_size != 0)
+            throw std::invalid_argument("OpenCLSorter: scatter_tile must be a multiple of local_size");
+
+        cl_ulong max_alloc = 0;
+        clGetDeviceInfo(device_, CL_DEVICE_MAX_MEM_ALLOC_SIZE, sizeof(max_alloc), &max_alloc, nullptr);
+        max_alloc_ = max_alloc;
+        clGetDeviceInfo(device_, CL_DEVICE_MAX_COMPUTE_UNITS, sizeof(compute_units_), &compute_units_, nullptr);
+        if (cfg_.local_scatter) {
+            // scatter_local's tile double buffer, scan and digit starts
+            cl_ulong local_mem = 0;
+            clGetDeviceInfo(device_, CL_DEVICE_LOCAL_MEM_SIZE, sizeof(local_mem), &local_mem, nullptr);
+            size_t need = 2 * sizeof(cl_ulong) * tile_keys() + sizeof(cl_uint) * (cfg_.local_size + (size_t(1) << cfg_.bits));
+            if (need > local_mem)
+                throw std::invalid_argument("OpenCLSorter: scatter_tile needs " + std::to_string(need) +
+                                            " bytes of local memory, device has " + std::to_string(local_mem));
+        }
+
+        // CPU devices and integrated GPUs share host memory; the (deprecated but
+        // still widely reported) unified-memory query covers the latter
+        cl_device_type type = 0;
+        cl_bool unified = CL_FALSE;
+        clGetDeviceInfo(device_, CL_DEVICE_TYPE, sizeof(type), &type, nullptr);
+        if (clGetDeviceInfo(device_, CL_DEVICE_HOST_UNIFIED_MEMORY, sizeof(unified), &unified, nullptr) != CL_SUCCESS)
+            unified = CL_FALSE;
+        zero_copy_ = cfg_.zero_copy == ZeroCopy::On ||
+                     (cfg_.zero_copy == ZeroCopy::Auto && ((type & CL_DEVICE_TYPE_CPU) || unified));
+
+        cl_int err;
+        cl_context_properties ctx_props[] = { CL_CONTEXT_PLATFORM, cl_context_properties(platform), 0 };
+        ctx_ = clCreateContext(ctx_props, 1, &device_, nullptr, nullptr, &err);
+        check(err, "clCreateContext");
+        cl_queue_properties props[] = { CL_QUEUE_PROPERTIES, cl_queue_properties(cfg_.profile ? CL_QUEUE_PROFILING_ENABLE : 0), 0 };
+        queue_ = clCreateCommandQueueWithProperties(ctx_, device_, props, &err);
+        check(err, "clCreateCommandQueueWithProperties");
+        transfer_queue_ = clCreateCommandQueueWithProperties(ctx_, device_, props, &err);
+        check(err, "clCreateCommandQueueWithProperties");
+
+        build_kernels(narrow_, "uint");
+    } catch (...) {
+        release();
+        throw;
+    }
+}
+
+OpenCLSorter::~OpenCLSorter() { release(); }
+
+void OpenCLSorter::release() {
+    for (auto& pe : pending_) clReleaseEvent(pe.ev);
+    pending_.clear();
+    for (auto& b : pool_) {
+        if (b.mem) clReleaseMemObject(b.mem);
+        b = PooledBuffer();
+    }
+    release_kernels(narrow_);
+    release_kernels(wide_);
+    if (queue_) clReleaseCommandQueue(queue_);
+    if (transfer_queue_) clReleaseCommandQueue(transfer_queue_);
+    if (ctx_) clReleaseContext(ctx_);
+    queue_ = nullptr;
+    transfer_queue_ = nullptr;
+    ctx_ = nullptr;
+}
+
+void OpenCLSorter::build_kernels(Kernels& k, const char* offset_type) {
+    std::string opts = "-DBITS=" + std::to_string(cfg_.bits) + " -DLOCAL_SZ=" + std::to_string(cfg_.local_size) +
+                       " -DSCAN_BLOCK=" + std::to_string(cfg_.scan_block) + " -DITEMS=" + std::to_string(cfg_.items) +
+                       " -DSCATTER_TILE=" + std::to_string(tile_keys()) +
+                       " -DOFFSET_T=" + offset_type;
+    k.prog = build_program(ctx_, device_, opts, cfg_.cache_dir);
+    k.hist = create_kernel(k.prog, "build_group_histogram");
+    k.reduce = create_kernel(k.prog, "reduce_group_blocks");
+    k.scan = create_kernel(k.prog, "scan_digit_blocks");
+    k.offsets = create_kernel(k.prog, "scan_group_offsets");
+    k.scatter = create_kernel(k.prog, "scatter_stable");
+    k.scatter_local = create_kernel(k.prog, "scatter_local");
+    k.scatter_kv32 = create_kernel(k.prog, "scatter_stable_kv32");
+    k.scatter_kv64 = create_kernel(k.prog, "scatter_stable_kv64");
+    k.segment_ids = create_kernel(k.prog, "segment_ids");
+    k.global_hist = create_kernel(k.prog, "global_histogram");
+    k.pass_scan = create_kernel(k.prog, "scan_pass_digits");
+    k.onesweep = create_kernel(k.prog, "onesweep_scatter");
+}
+
+void OpenCLSorter::release_kernels(Kernels& k) {
+    for (cl_kernel c : {k.hist, k.reduce, k.scan, k.offsets, k.scatter, k.scatter_local, k.scatter_kv32, k.scatter_kv64,
+                        k.segment_ids, k.global_hist, k.pass_scan, k.onesweep})
+        if (c) clReleaseKernel(c);
+    if (k.prog) clReleaseProgram(k.prog);
+    k = Kernels();
+}
+
+const OpenCLSorter::Kernels& OpenCLSorter::kernels(bool wide) {
+    if (!wide) return narrow_;
+    if (!wide_.prog) {
+        try {
+            build_kernels(wide_, "ulong");
+        } catch (...) {
+            release_kernels(wide_);
+            throw;
+        }
+    }
+    return wide_;
+}
+
+// 32-bit offsets hold key counts, every per-group histogram index and every
+// key index a group visits: the last tile may reach past N, by up to a tile
+// less one key, and must not wrap back below it
+bool OpenCLSorter::wide_offsets(size_t N) const {
+    size_t groups = (N + tile_keys() - 1) / tile_keys();
+    return cfg_.offsets64 || N > UINT32_MAX || groups * (size_t(1) << cfg_.bits) > UINT32_MAX
+        || groups * tile_keys() > UINT32_MAX;
+}
+
+std::string OpenCLSorter::device_name() const { return device_string(device_, CL_DEVICE_NAME); }
+
+size_t OpenCLSorter::pooled_bytes() const {
+    size_t total = 0;
+    for (auto& b : pool_) total += b.bytes;
+    return total;
+}
+
+// Returns a buffer of at least `bytes`. A slot that is too small is replaced
+// by one at least twice its size (capped by the device's allocation limit), so
+// a growing workload reallocates O(log n) times.
+cl_mem OpenCLSorter::reserve(Slot s, size_t bytes) {
+    PooledBuffer& b = pool_[s];
+    if (b.bytes >= bytes) return b.mem;
+    size_t grown = std::max(bytes, std::min<size_t>(2 * b.bytes, max_alloc_));
+    if (b.mem) clReleaseMemObject(b.mem);
+    b = PooledBuffer();
     cl_int err;
-    cl_context ctx = clCreateContext(nullptr, 1, &d, nullptr, nullptr, &err);
-    assert(err == CL_SUCCESS);
-    cl_queue_properties props[] = { 0 };
-    cl_command_queue q = clCreateCommandQueueWithProperties(ctx, d, props, &err);
-    assert(err == CL_SUCCESS);
-
-    // 2) Build program & kernels
-    auto src = load("../kernels/radix_kernels.cl");
-    const char* s = src.c_str();
-    cl_program prog = clCreateProgramWithSource(ctx, 1, &s, nullptr, &err);
-    assert(err == CL_SUCCESS);
-    err = clBuildProgram(prog, 1, &d, nullptr, nullptr, nullptr);
-    assert(err == CL_SUCCESS);
-    cl_kernel kh = clCreateKernel(prog, "build_group_histogram", &err);
-    assert(err == CL_SUCCESS);
-    cl_kernel ks = clCreateKernel(prog, "scatter_stable", &err);
-    assert(err == CL_SUCCESS);
-
-    // 3) Allocate buffers
-    cl_mem buf_in  = clCreateBuffer(ctx, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
-                        N * sizeof(cl_ulong), (void*)in.data(), &err);
-    assert(err == CL_SUCCESS);
-    cl_mem buf_out = clCreateBuffer(ctx, CL_MEM_READ_WRITE,
-                        N * sizeof(cl_ulong), nullptr, &err);
-    assert(err == CL_SUCCESS);
-    cl_mem buf_gh = clCreateBuffer(ctx, CL_MEM_READ_WRITE,
-                        NUM_GROUPS * RADIX * sizeof(cl_uint), nullptr, &err);
-    assert(err == CL_SUCCESS);
-    cl_mem buf_pg = clCreateBuffer(ctx, CL_MEM_READ_WRITE,
-                        RADIX * sizeof(cl_uint), nullptr, &err);
-    assert(err == CL_SUCCESS);
-    cl_mem buf_go = clCreateBuffer(ctx, CL_MEM_READ_WRITE,
-                        NUM_GROUPS * RADIX * sizeof(cl_uint), nullptr, &err);
-    assert(err == CL_SUCCESS);
-
-    // temp host arrays
-    std::vector<uint32_t> gh(NUM_GROUPS * RADIX),
-                          bt(RADIX),
-                          pg(RADIX),
-                          go(NUM_GROUPS * RADIX),
-                          zero(NUM_GROUPS * RADIX, 0);
+    b.mem = clCreateBuffer(ctx_, CL_MEM_READ_WRITE, grown, nullptr, &err);
+    check(err, "clCreateBuffer");
+    b.bytes = grown;
+    return b.mem;
+}
+
+// Enqueues all passes over keys[0..N) on the compute queue, ping-ponging with
+// scratch. The first command waits for `wait`; `done` (if given) fires after
+// the last scatter. Returns the buffer that holds the sorted keys.
+cl_mem OpenCLSorter::enqueue_sort(cl_mem buf_in, cl_mem buf_out, size_t N,
+                                  const std::vector<cl_event>& wait, cl_event* done) {
+    if (cfg_.pipeline == Pipeline::Onesweep && N < (size_t(1) << 30))
+        return enqueue_onesweep(buf_in, buf_out, N, wait, done);
+    cl_mem no_values = nullptr, no_scratch = nullptr;
+    enqueue_classic(buf_in, buf_out, no_values, no_scratch, 0, (64 + cfg_.bits - 1) / cfg_.bits, N, wait, done);
+    return buf_in;
+}
+
+// The classic pipeline over the low passes * bits bits of keys[0..N). With
+// value_bytes 4 or 8, values[0..N) move with their keys. Each buffer pair is
+// swapped as it ping-pongs, so on return keys and values hold the result.
+void OpenCLSorter::enqueue_classic(cl_mem& buf_in, cl_mem& buf_out, cl_mem& val_in, cl_mem& val_out,
+                                   size_t value_bytes, int PASSES, size_t N,
+                                   const std::vector<cl_event>& wait, cl_event* done) {
+    if (wide_offsets(N)) enqueue_passes<cl_ulong>(buf_in, buf_out, val_in, val_out, value_bytes, PASSES, N, wait, done);
+    else enqueue_passes<cl_uint>(buf_in, buf_out, val_in, val_out, value_bytes, PASSES, N, wait, done);
+}
+
+// enqueue_classic with counts and offsets of type Offset (cl_uint or cl_ulong)
+template <class Offset>
+void OpenCLSorter::enqueue_passes(cl_mem& buf_in, cl_mem& buf_out, cl_mem& val_in, cl_mem& val_out,
+                                  size_t value_bytes, int PASSES, size_t N,
+                                  const std::vector<cl_event>& wait, cl_event* done) {
+    const Kernels& K = kernels(sizeof(Offset) == sizeof(cl_ulong));
+    const int    BITS      = cfg_.bits;
+    const int    RADIX     = 1 << BITS;
+    const size_t LOCAL_SZ  = cfg_.local_size;
+    const size_t TILE      = tile_keys();
+    const size_t NUM_GROUPS= (N + TILE - 1) / TILE;
+    const size_t GLOBAL_SZ = NUM_GROUPS * LOCAL_SZ;
+    const size_t SCAN_BLOCK= cfg_.scan_block;
+    const size_t NUM_BLOCKS= (NUM_GROUPS + SCAN_BLOCK - 1) / SCAN_BLOCK;
+    const size_t RADIX_SZ  = RADIX;
+    const size_t BLOCKS_SZ = NUM_BLOCKS * RADIX;
+    const size_t KEY_BYTES = N * sizeof(cl_ulong);
+    const size_t GH_BYTES  = NUM_GROUPS * RADIX * sizeof(Offset);
 
+    cl_mem buf_gh  = reserve(GROUP_HIST, GH_BYTES);
+    cl_mem buf_go  = reserve(GROUP_OFFSETS, GH_BYTES);
+    cl_mem buf_bs  = reserve(BLOCK_SUMS, NUM_BLOCKS * RADIX * sizeof(Offset));
+    cl_mem buf_pg  = reserve(DIGIT_OFFSETS, RADIX * sizeof(Offset));
+
+    // scan kernels never change arguments within a sort
+    Offset n = N, ng = NUM_GROUPS, nb = NUM_BLOCKS;
+    clSetKernelArg(K.reduce, 0, sizeof(buf_gh), &buf_gh);
+    clSetKernelArg(K.reduce, 1, sizeof(buf_bs), &buf_bs);
+    clSetKernelArg(K.reduce, 2, sizeof(Offset), &ng);
+    clSetKernelArg(K.scan, 0, sizeof(buf_bs), &buf_bs);
+    clSetKernelArg(K.scan, 1, sizeof(buf_pg), &buf_pg);
+    clSetKernelArg(K.scan, 2, sizeof(Offset), &nb);
+    clSetKernelArg(K.offsets, 0, sizeof(buf_gh), &buf_gh);
+    clSetKernelArg(K.offsets, 1, sizeof(buf_bs), &buf_bs);
+    clSetKernelArg(K.offsets, 2, sizeof(buf_go), &buf_go);
+    clSetKernelArg(K.offsets, 3, sizeof(Offset), &ng);
+
+    // All passes are enqueued back to back on the in-order queue; nothing
+    // returns to the host until the caller reads the result.
     for (int pass = 0; pass < PASSES; ++pass) {
-      uint32_t shift = pass * BITS;
-
-      // zero per-group hist
-      ENQUEUE_WRITE(q, buf_gh, CL_TRUE, 0, zero.size() * sizeof(zero[0]), zero.data(),
-                    0, nullptr, nullptr);
-
-      // build_group_histogram
-      clSetKernelArg(kh, 0, sizeof(buf_in), &buf_in);
-      clSetKernelArg(kh, 1, sizeof(buf_gh), &buf_gh);
-      clSetKernelArg(kh, 2, sizeof(uint32_t), &N);
-      clSetKernelArg(kh, 3, sizeof(uint32_t), &shift);
-      clEnqueueNDRangeKernel(q, kh, 1, nullptr, &GLOBAL_SZ, &LOCAL_SZ, 0, nullptr, nullptr);
-      clFinish(q);
-
-      // read back gh
-      ENQUEUE_READ(q, buf_gh, CL_TRUE, 0, gh.size() * sizeof(gh[0]), gh.data(),
-                   0, nullptr, nullptr);
-
-      // bucket_totals & prefix-sum across digits (host)
-      for (int d = 0; d < RADIX; ++d) {
-        uint32_t sum = 0;
-        for (size_t g = 0; g < NUM_GROUPS; ++g)
-          sum += gh[g * RADIX + d];
-        bt[d] = sum;
-      }
-      pg[0] = 0;
-      for (int d = 1; d < RADIX; ++d) pg[d] = pg[d - 1] + bt[d - 1];
-
-      // group_offsets
-      for (int d = 0; d < RADIX; ++d) {
-        uint32_t sum = 0;
-        for (size_t g = 0; g < NUM_GROUPS; ++g) {
-          go[g * RADIX + d] = sum;
-          sum += gh[g * RADIX + d];
+        cl_uint shift = pass * BITS;
+
+        // build_group_histogram overwrites every row of gh, so it needs no clear
+        clSetKernelArg(K.hist, 0, sizeof(buf_in), &buf_in);
+        clSetKernelArg(K.hist, 1, sizeof(buf_gh), &buf_gh);
+        clSetKernelArg(K.hist, 2, sizeof(Offset), &n);
+        clSetKernelArg(K.hist, 3, sizeof(cl_uint), &shift);
+        cl_event* ev = event_slot(nullptr);
+        check(clEnqueueNDRangeKernel(queue_, K.hist, 1, nullptr, &GLOBAL_SZ, &LOCAL_SZ,
+                                     pass == 0 ? cl_uint(wait.size()) : 0,
+                                     pass == 0 && !wait.empty() ? wait.data() : nullptr, ev),
+              "build_group_histogram");
+        record(ev, "histogram", pass, KEY_BYTES + GH_BYTES, 0);
+
+        // bucket totals, digit prefix (pg) and group offsets (go) on the device
+        ev = event_slot(nullptr);
+        check(clEnqueueNDRangeKernel(queue_, K.reduce, 1, nullptr, &BLOCKS_SZ, &RADIX_SZ, 0, nullptr, ev),
+              "reduce_group_blocks");
+        record(ev, "scan", pass, GH_BYTES, 0);
+        ev = event_slot(nullptr);
+        check(clEnqueueNDRangeKernel(queue_, K.scan, 1, nullptr, &RADIX_SZ, &RADIX_SZ, 0, nullptr, ev),
+              "scan_digit_blocks");
+        record(ev, "scan", pass, 2 * BLOCKS_SZ * sizeof(Offset), 0);
+        ev = event_slot(nullptr);
+        check(clEnqueueNDRangeKernel(queue_, K.offsets, 1, nullptr, &BLOCKS_SZ, &RADIX_SZ, 0, nullptr, ev),
+              "scan_group_offsets");
+        record(ev, "scan", pass, 2 * GH_BYTES, 0);
+
+        // scatter_stable, or a key-value variant
+        cl_kernel k = value_bytes == 4 ? K.scatter_kv32 : value_bytes == 8 ? K.scatter_kv64 :
+                      cfg_.local_scatter ? K.scatter_local : K.scatter;
+        cl_uint a = 0;
+        clSetKernelArg(k, a++, sizeof(buf_in), &buf_in);
+        clSetKernelArg(k, a++, sizeof(buf_out), &buf_out);
+        if (value_bytes) {
+            clSetKernelArg(k, a++, sizeof(val_in), &val_in);
+            clSetKernelArg(k, a++, sizeof(val_out), &val_out);
         }
-      }
+        clSetKernelArg(k, a++, sizeof(buf_pg), &buf_pg);
+        clSetKernelArg(k, a++, sizeof(buf_go), &buf_go);
+        clSetKernelArg(k, a++, sizeof(Offset), &n);
+        clSetKernelArg(k, a++, sizeof(cl_uint), &shift);
+        ev = event_slot(pass == PASSES - 1 ? done : nullptr);
+        check(clEnqueueNDRangeKernel(queue_, k, 1, nullptr, &GLOBAL_SZ, &LOCAL_SZ, 0, nullptr, ev),
+              "scatter_stable");
+        record(ev, "scatter", pass, 2 * (KEY_BYTES + N * value_bytes) + GH_BYTES, 0);
+
+        // swap buffers
+        std::swap(val_in, val_out);
+        std::swap(buf_in, buf_out);
+    }
+}
+
+// Onesweep counterpart of enqueue_sort, same contract
+cl_mem OpenCLSorter::enqueue_onesweep(cl_mem buf_in, cl_mem buf_out, size_t N,
+                                      const std::vector<cl_event>& wait, cl_event* done) {
+    const Kernels& K = narrow_;
+
+    const int    BITS       = cfg_.bits;
+    const int    RADIX      = 1 << BITS;
+    const size_t LOCAL_SZ   = cfg_.local_size;
+    const size_t TILE       = LOCAL_SZ * cfg_.items;
+    const size_t NUM_TILES  = (N + TILE - 1) / TILE;
+    const size_t GLOBAL_SZ  = NUM_TILES * LOCAL_SZ;
+    const int    PASSES     = (64 + BITS - 1) / BITS;
+    const size_t RADIX_SZ   = RADIX;
+    const size_t SCAN_SZ    = PASSES * RADIX_SZ;
+    const size_t KEY_BYTES  = N * sizeof(cl_ulong);
+    const size_t STATUS_LEN = NUM_TILES * RADIX;
+    const size_t SWEEP_LEN  = PASSES * RADIX + PASSES;
+    // a few groups per compute unit; more would only add global atomics
+    const size_t HIST_SZ    = std::min<size_t>(NUM_TILES, 4 * compute_units_) * LOCAL_SZ;
+
+    cl_mem buf_status[2] = { reserve(GROUP_HIST, STATUS_LEN * sizeof(cl_uint)),
+                             reserve(GROUP_OFFSETS, STATUS_LEN * sizeof(cl_uint)) };
+    cl_mem buf_sweep = reserve(DIGIT_OFFSETS, SWEEP_LEN * sizeof(cl_uint));
+
+    // digit counts accumulate across groups, so they start from a device-side fill
+    cl_uint n32 = cl_uint(N), status_len = STATUS_LEN, zero = 0;
+    cl_event* ev = event_slot(nullptr);
+    check(clEnqueueFillBuffer(queue_, buf_sweep, &zero, sizeof(zero), 0, SWEEP_LEN * sizeof(cl_uint),
+                              cl_uint(wait.size()), wait.empty() ? nullptr : wait.data(), ev),
+          "clEnqueueFillBuffer");
+    record(ev, "clear", -1, SWEEP_LEN * sizeof(cl_uint), 0);
+
+    clSetKernelArg(K.global_hist, 0, sizeof(buf_in), &buf_in);
+    clSetKernelArg(K.global_hist, 1, sizeof(buf_sweep), &buf_sweep);
+    clSetKernelArg(K.global_hist, 2, sizeof(buf_status[0]), &buf_status[0]);
+    clSetKernelArg(K.global_hist, 3, sizeof(cl_uint), &n32);
+    clSetKernelArg(K.global_hist, 4, sizeof(cl_uint), &status_len);
+    ev = event_slot(nullptr);
+    check(clEnqueueNDRangeKernel(queue_, K.global_hist, 1, nullptr, &HIST_SZ, &LOCAL_SZ, 0, nullptr, ev),
+          "global_histogram");
+    record(ev, "histogram", -1, KEY_BYTES + STATUS_LEN * sizeof(cl_uint), 0);
+
+    clSetKernelArg(K.pass_scan, 0, sizeof(buf_sweep), &buf_sweep);
+    ev = event_slot(nullptr);
+    check(clEnqueueNDRangeKernel(queue_, K.pass_scan, 1, nullptr, &SCAN_SZ, &RADIX_SZ, 0, nullptr, ev),
+          "scan_pass_digits");
+    record(ev, "scan", -1, 2 * SCAN_SZ * sizeof(cl_uint), 0);
+
+    clSetKernelArg(K.onesweep, 2, sizeof(buf_sweep), &buf_sweep);
+    clSetKernelArg(K.onesweep, 5, sizeof(cl_uint), &n32);
+    for (int pass = 0; pass < PASSES; ++pass) {
+        cl_uint p = pass;
+        clSetKernelArg(K.onesweep, 0, sizeof(buf_in), &buf_in);
+        clSetKernelArg(K.onesweep, 1, sizeof(buf_out), &buf_out);
+        clSetKernelArg(K.onesweep, 3, sizeof(cl_mem), &buf_status[pass % 2]);
+        clSetKernelArg(K.onesweep, 4, sizeof(cl_mem), &buf_status[(pass + 1) % 2]);
+        clSetKernelArg(K.onesweep, 6, sizeof(cl_uint), &p);
+        ev = event_slot(pass == PASSES - 1 ? done : nullptr);
+        check(clEnqueueNDRangeKernel(queue_, K.onesweep, 1, nullptr, &GLOBAL_SZ, &LOCAL_SZ, 0, nullptr, ev),
+              "onesweep_scatter");
+        // status is read back by look-back about once per tile
+        record(ev, "scatter", pass, 2 * KEY_BYTES + 3 * STATUS_LEN * sizeof(cl_uint), 0);
+        std::swap(buf_in, buf_out);
+    }
+    return buf_in;
+}
+
+// splitmix64 finaliser
+static uint64_t mix64(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+// Order-independent 128-bit hash of a multiset of keys: two sums of
+// independently mixed keys. Sums (unlike xor) keep duplicate keys apart.
+static std::pair<uint64_t, uint64_t> multiset_fingerprint(const uint64_t* k, size_t n) {
+    uint64_t a = 0, b = 0;
+    for (size_t i = 0; i < n; ++i) {
+        a += mix64(k[i] + 0x9e3779b97f4a7c15ull);
+        b += mix64(k[i] ^ 0xd6e8feb86659fd93ull);
+    }
+    return {a, b};
+}
 
-      // upload pg & go
-      ENQUEUE_WRITE(q, buf_pg, CL_TRUE, 0, pg.size() * sizeof(pg[0]), pg.data(),
-                    0, nullptr, nullptr);
-      ENQUEUE_WRITE(q, buf_go, CL_TRUE, 0, go.size() * sizeof(go[0]), go.data(),
-                    0, nullptr, nullptr);
+// Same for (key, tag) pairs, where the tag is a payload or a segment index
+static void fold_pair(std::pair<uint64_t, uint64_t>& f, uint64_t key, uint64_t tag) {
+    uint64_t t = mix64(tag ^ 0x2545f4914f6cdd1dull);
+    f.first += mix64(key + t);
+    f.second += mix64((key ^ 0xd6e8feb86659fd93ull) - t);
+}
+
+// What the chosen verification mode needs to remember about the input
+struct Expected {
+    Verify mode;
+    std::vector<uint64_t> sorted;              // Full: std::sort of the input
+    std::pair<uint64_t, uint64_t> fingerprint; // Fingerprint
+};
 
-      // scatter_stable
-      clSetKernelArg(ks, 0, sizeof(buf_in), &buf_in);
-      clSetKernelArg(ks, 1, sizeof(buf_out), &buf_out);
-      clSetKernelArg(ks, 2, sizeof(buf_pg), &buf_pg);
-      clSetKernelArg(ks, 3, sizeof(buf_go), &buf_go);
-      clSetKernelArg(ks, 4, sizeof(uint32_t), &N);
-      clSetKernelArg(ks, 5, sizeof(uint32_t), &shift);
-      clEnqueueNDRangeKernel(q, ks, 1, nullptr, &GLOBAL_SZ, &LOCAL_SZ, 0, nullptr, nullptr);
-      clFinish(q);
+static Expected expect(const uint64_t* in, size_t n, Verify mode) {
+    Expected e{mode, {}, {0, 0}};
+    if (mode == Verify::Full) {
+        e.sorted.assign(in, in + n);
+        std::sort(e.sorted.begin(), e.sorted.end());
+    } else if (mode == Verify::Fingerprint) {
+        e.fingerprint = multiset_fingerprint(in, n);
+    }
+    return e;
+}
 
-      // swap buffers
-      std::swap(buf_in, buf_out);
+static bool matches(const Expected& e, const uint64_t* out, size_t n) {
+    switch (e.mode) {
+    case Verify::Off: return true;
+    case Verify::Full: return std::equal(out, out + n, e.sorted.begin());
+    case Verify::Fingerprint: return std::is_sorted(out, out + n) && multiset_fingerprint(out, n) == e.fingerprint;
     }
+    return false;
+}
+
+void OpenCLSorter::sort(uint64_t* data, size_t N) {
+    Expected e = expect(data, N, cfg_.verify);
+    if (N > device_keys()) stream_chunks(data, data, N);  // runs are downloaded to a copy, so in == out is safe
+    else sort_on_device(data, N);
+    if (!matches(e, data, N)) throw std::runtime_error("OpenCLSorter: result is not the sorted input");
+}
+
+void OpenCLSorter::sort_on_device(uint64_t* data, size_t N) {
+    if (N == 0) return;
+    if (zero_copy_) return sort_in_place(data, N);
+    cl_mem buf_in  = reserve(KEYS_A, N * sizeof(cl_ulong));
+    cl_mem buf_out = reserve(KEYS_B, N * sizeof(cl_ulong));
+    cl_event* ev = event_slot(nullptr);
+    ENQUEUE_WRITE(queue_, buf_in, CL_FALSE, 0, N * sizeof(cl_ulong), data, 0, nullptr, ev);
+    record(ev, "H->D", -1, N * sizeof(cl_ulong), 0);
+    cl_mem sorted = enqueue_sort(buf_in, buf_out, N, {}, nullptr);
 
     // read back final sorted data
-    ENQUEUE_READ(q, buf_in, CL_TRUE, 0, N * sizeof(cl_ulong), out.data(),
-                 0, nullptr, nullptr);
+    ev = event_slot(nullptr);
+    ENQUEUE_READ(queue_, sorted, CL_TRUE, 0, N * sizeof(cl_ulong), data, 0, nullptr, ev);
+    record(ev, "D->H", -1, N * sizeof(cl_ulong), 0);
+}
+
+// Zero-copy sort: the device works directly on the caller's memory through a
+// CL_MEM_USE_HOST_PTR buffer, and a blocking map/unmap makes the result visible
+// to the host. No bytes cross the transfer counters. An odd number of passes
+// leaves the result in scratch, which is copied back on the device.
+void OpenCLSorter::sort_in_place(uint64_t* data, size_t N) {
+    cl_int err;
+    cl_mem host_keys = clCreateBuffer(ctx_, CL_MEM_READ_WRITE | CL_MEM_USE_HOST_PTR, N * sizeof(cl_ulong), data, &err);
+    check(err, "clCreateBuffer(CL_MEM_USE_HOST_PTR)");
+    try {
+        cl_mem scratch = reserve(KEYS_B, N * sizeof(cl_ulong));
+        cl_mem sorted = enqueue_sort(host_keys, scratch, N, {}, nullptr);
+        if (sorted != host_keys) {
+            cl_event* ev = event_slot(nullptr);
+            check(clEnqueueCopyBuffer(queue_, sorted, host_keys, 0, 0, N * sizeof(cl_ulong), 0, nullptr, ev),
+                  "clEnqueueCopyBuffer");
+            record(ev, "copy", -1, 2 * N * sizeof(cl_ulong), 0);
+        }
+        void* p = clEnqueueMapBuffer(queue_, host_keys, CL_TRUE, CL_MAP_READ, 0, N * sizeof(cl_ulong),
+                                     0, nullptr, nullptr, &err);
+        check(err, "clEnqueueMapBuffer");
+        check(clEnqueueUnmapMemObject(queue_, host_keys, p, 0, nullptr, nullptr), "clEnqueueUnmapMemObject");
+        check(clFinish(queue_), "clFinish");
+    } catch (...) {
+        clReleaseMemObject(host_keys);
+        throw;
+    }
+    clReleaseMemObject(host_keys);
+}
+
+void OpenCLSorter::sort_pairs(uint64_t* keys, uint32_t* values, size_t N) { sort_pairs_on_device(keys, values, N); }
+void OpenCLSorter::sort_pairs(uint64_t* keys, uint64_t* values, size_t N) { sort_pairs_on_device(keys, values, N); }
+
+template <class V>
+void OpenCLSorter::sort_pairs_on_device(uint64_t* keys, V* values, size_t N) {
+    std::vector<std::pair<uint64_t, V>> full;
+    std::pair<uint64_t, uint64_t> fp{0, 0};
+    if (cfg_.verify == Verify::Full) {
+        for (size_t i = 0; i < N; ++i) full.push_back({keys[i], values[i]});
+        std::stable_sort(full.begin(), full.end(), [](auto& a, auto& b) { return a.first < b.first; });
+    } else if (cfg_.verify == Verify::Fingerprint) {
+        for (size_t i = 0; i < N; ++i) fold_pair(fp, keys[i], values[i]);
+    }
+
+    if (N > 0) {
+        cl_mem buf_keys = reserve(KEYS_A, N * sizeof(cl_ulong)), buf_scratch = reserve(KEYS_B, N * sizeof(cl_ulong));
+        cl_mem buf_vals = reserve(VALUES_A, N * sizeof(V)), buf_vscratch = reserve(VALUES_B, N * sizeof(V));
+        cl_event* ev = event_slot(nullptr);
+        ENQUEUE_WRITE(queue_, buf_keys, CL_FALSE, 0, N * sizeof(cl_ulong), keys, 0, nullptr, ev);
+        record(ev, "H->D", -1, N * sizeof(cl_ulong), 0);
+        ev = event_slot(nullptr);
+        ENQUEUE_WRITE(queue_, buf_vals, CL_FALSE, 0, N * sizeof(V), values, 0, nullptr, ev);
+        record(ev, "H->D", -1, N * sizeof(V), 0);
+        enqueue_classic(buf_keys, buf_scratch, buf_vals, buf_vscratch, sizeof(V), (64 + cfg_.bits - 1) / cfg_.bits,
+                        N, {}, nullptr);
+        ev = event_slot(nullptr);
+        ENQUEUE_READ(queue_, buf_keys, CL_FALSE, 0, N * sizeof(cl_ulong), keys, 0, nullptr, ev);
+        record(ev, "D->H", -1, N * sizeof(cl_ulong), 0);
+        ev = event_slot(nullptr);
+        ENQUEUE_READ(queue_, buf_vals, CL_TRUE, 0, N * sizeof(V), values, 0, nullptr, ev);
+        record(ev, "D->H", -1, N * sizeof(V), 0);
+    }
+
+    bool ok = true;
+    if (cfg_.verify == Verify::Full) {
+        for (size_t i = 0; i < N && ok; ++i) ok = keys[i] == full[i].first && values[i] == full[i].second;
+    } else if (cfg_.verify == Verify::Fingerprint) {
+        std::pair<uint64_t, uint64_t> out{0, 0};
+        for (size_t i = 0; i < N; ++i) fold_pair(out, keys[i], values[i]);
+        ok = std::is_sorted(keys, keys + N) && out == fp;
+    }
+    if (!ok) throw std::runtime_error("OpenCLSorter: result is not the sorted input pairs");
+}
+
+void OpenCLSorter::sort_segments(uint64_t* keys, size_t N, const std::vector<size_t>& offsets) {
+    if (offsets.empty() || offsets.front() != 0 || offsets.back() != N ||
+        !std::is_sorted(offsets.begin(), offsets.end()))
+        throw std::invalid_argument("OpenCLSorter::sort_segments: offsets must rise from 0 to n");
+    size_t S = offsets.size() - 1;
+
+    std::vector<uint64_t> full;
+    std::pair<uint64_t, uint64_t> fp{0, 0};
+    if (cfg_.verify == Verify::Full) {
+        full.assign(keys, keys + N);
+        for (size_t s = 0; s < S; ++s) std::sort(full.begin() + offsets[s], full.begin() + offsets[s + 1]);
+    } else if (cfg_.verify == Verify::Fingerprint) {
+        for (size_t s = 0; s < S; ++s)
+            for (size_t i = offsets[s]; i < offsets[s + 1]; ++i) fold_pair(fp, keys[i], s);
+    }
+
+    if (wide_offsets(N)) sort_segments_on_device<cl_ulong>(keys, N, offsets);
+    else sort_segments_on_device<cl_uint>(keys, N, offsets);
+
+    bool ok = true;
+    if (cfg_.verify == Verify::Full) {
+        ok = std::equal(keys, keys + N, full.begin());
+    } else if (cfg_.verify == Verify::Fingerprint) {
+        std::pair<uint64_t, uint64_t> out{0, 0};
+        for (size_t s = 0; s < S && ok; ++s) {
+            ok = std::is_sorted(keys + offsets[s], keys + offsets[s + 1]);
+            for (size_t i = offsets[s]; i < offsets[s + 1]; ++i) fold_pair(out, keys[i], s);
+        }
+        ok = ok && out == fp;
+    }
+    if (!ok) throw std::runtime_error("OpenCLSorter: result is not the segment-wise sorted input");
+}
+
+// Tags every key with its segment id, sorts by key carrying the ids, then by
+// id carrying the keys. Both sorts are stable, so keys end up grouped by
+// segment in their original segment order and sorted within each.
+template <class Offset>
+void OpenCLSorter::sort_segments_on_device(uint64_t* keys, size_t N, const std::vector<size_t>& offsets) {
+    if (N == 0) return;
+    const Kernels& K = kernels(sizeof(Offset) == sizeof(cl_ulong));
+    size_t S = offsets.size() - 1;
+    std::vector<Offset> offsets_dev(offsets.begin(), offsets.end());
+
+    const size_t LOCAL_SZ  = cfg_.local_size;
+    const size_t GLOBAL_SZ = (N + LOCAL_SZ - 1) / LOCAL_SZ * LOCAL_SZ;
+    int id_bits = 0;
+    while (id_bits < 64 && (S - 1) >> id_bits) ++id_bits;
+
+    cl_mem buf_keys = reserve(KEYS_A, N * sizeof(cl_ulong)), buf_scratch = reserve(KEYS_B, N * sizeof(cl_ulong));
+    cl_mem buf_ids = reserve(VALUES_A, N * sizeof(cl_ulong)), buf_id_scratch = reserve(VALUES_B, N * sizeof(cl_ulong));
+    cl_mem buf_offsets = reserve(SEGMENT_OFFSETS, offsets_dev.size() * sizeof(Offset));
+    cl_event* ev = event_slot(nullptr);
+    ENQUEUE_WRITE(queue_, buf_keys, CL_FALSE, 0, N * sizeof(cl_ulong), keys, 0, nullptr, ev);
+    record(ev, "H->D", -1, N * sizeof(cl_ulong), 0);
+    ev = event_slot(nullptr);
+    ENQUEUE_WRITE(queue_, buf_offsets, CL_FALSE, 0, offsets_dev.size() * sizeof(Offset), offsets_dev.data(),
+                  0, nullptr, ev);
+    record(ev, "H->D", -1, offsets_dev.size() * sizeof(Offset), 0);
+
+    Offset s = S, n = N;
+    clSetKernelArg(K.segment_ids, 0, sizeof(buf_offsets), &buf_offsets);
+    clSetKernelArg(K.segment_ids, 1, sizeof(buf_ids), &buf_ids);
+    clSetKernelArg(K.segment_ids, 2, sizeof(Offset), &s);
+    clSetKernelArg(K.segment_ids, 3, sizeof(Offset), &n);
+    ev = event_slot(nullptr);
+    check(clEnqueueNDRangeKernel(queue_, K.segment_ids, 1, nullptr, &GLOBAL_SZ, &LOCAL_SZ, 0, nullptr, ev),
+          "segment_ids");
+    record(ev, "segment_ids", -1, N * sizeof(cl_ulong), 0);
+
+    enqueue_passes<Offset>(buf_keys, buf_scratch, buf_ids, buf_id_scratch, sizeof(cl_ulong),
+                           (64 + cfg_.bits - 1) / cfg_.bits, N, {}, nullptr);
+    if (id_bits > 0)
+        enqueue_passes<Offset>(buf_ids, buf_id_scratch, buf_keys, buf_scratch, sizeof(cl_ulong),
+                               (id_bits + cfg_.bits - 1) / cfg_.bits, N, {}, nullptr);
+
+    ev = event_slot(nullptr);
+    ENQUEUE_READ(queue_, buf_keys, CL_TRUE, 0, N * sizeof(cl_ulong), keys, 0, nullptr, ev);
+    record(ev, "D->H", -1, N * sizeof(cl_ulong), 0);
+}
+
+// Keys one sort can hold on the device: keys and scratch plus the per-group
+// histograms and offsets, counted at 64 bits, within global memory and the
+// per-buffer allocation limit
+size_t OpenCLSorter::device_keys() const {
+    cl_ulong global_mem = 0;
+    clGetDeviceInfo(device_, CL_DEVICE_GLOBAL_MEM_SIZE, sizeof(global_mem), &global_mem, nullptr);
+    size_t hist = std::max<size_t>(sizeof(cl_ulong) * (size_t(1) << cfg_.bits) / tile_keys(), 1);
+    size_t keys = global_mem / (2 * sizeof(cl_ulong) + 2 * hist);
+    return std::min({keys, max_alloc_ / sizeof(cl_ulong), max_alloc_ / hist});
+}
+
+size_t OpenCLSorter::tile_keys() const { return cfg_.scatter_tile ? cfg_.scatter_tile : cfg_.local_size; }
+
+// Keys per streamed chunk: two chunk slots share the device
+size_t OpenCLSorter::chunk_keys() const {
+    if (cfg_.chunk_keys) return cfg_.chunk_keys;
+    return device_keys() / 2;
+}
+
+// Streams in[0..N) through the device in chunks. Two chunk slots alternate:
+// while chunk i sorts on the compute queue, the transfer queue downloads chunk
+// i-1 and uploads chunk i+1. Events order each chunk's upload -> sort ->
+// download; the in-order transfer queue keeps a slot's next upload behind its
+// previous download. The sorted chunks are then k-way merged into out.
+void OpenCLSorter::sort_chunked(const uint64_t* in, uint64_t* out, size_t N) {
+    Expected e = expect(in, N, cfg_.verify);
+    stream_chunks(in, out, N);
+    if (!matches(e, out, N)) throw std::runtime_error("OpenCLSorter: result is not the sorted input");
+}
+
+void OpenCLSorter::stream_chunks(const uint64_t* in, uint64_t* out, size_t N) {
+    size_t chunk = chunk_keys();
+    if (N <= chunk) {
+        if (out != in) std::copy(in, in + N, out);
+        sort_on_device(out, N);
+        return;
+    }
+    size_t num_chunks = (N + chunk - 1) / chunk;
+    cl_mem keys[2]    = { reserve(KEYS_A, chunk * sizeof(cl_ulong)), reserve(KEYS_C, chunk * sizeof(cl_ulong)) };
+    cl_mem scratch[2] = { reserve(KEYS_B, chunk * sizeof(cl_ulong)), reserve(KEYS_D, chunk * sizeof(cl_ulong)) };
+    std::vector<uint64_t> runs(N);
+    std::vector<cl_event> uploaded(num_chunks), sorted(num_chunks), downloaded(num_chunks);
+    auto begin = [&](size_t i) { return i * chunk; };
+    auto len = [&](size_t i) { return std::min(chunk, N - i * chunk); };
+
+    auto release_events = [&] {
+        for (auto* evs : {&uploaded, &sorted, &downloaded})
+            for (cl_event e : *evs)
+                if (e) clReleaseEvent(e);
+    };
+
+    try {
+        ENQUEUE_WRITE(transfer_queue_, keys[0], CL_FALSE, 0, len(0) * sizeof(cl_ulong), in,
+                      0, nullptr, &uploaded[0]);
+        record(&uploaded[0], "H->D", -1, len(0) * sizeof(cl_ulong), 1);
+        for (size_t i = 0; i < num_chunks; ++i) {
+            int s = i % 2;
+            cl_mem result = enqueue_sort(keys[s], scratch[s], len(i), {uploaded[i]}, &sorted[i]);
+            clFlush(queue_);
+            if (i + 1 < num_chunks) {
+                ENQUEUE_WRITE(transfer_queue_, keys[1 - s], CL_FALSE, 0, len(i + 1) * sizeof(cl_ulong),
+                              in + begin(i + 1), 0, nullptr, &uploaded[i + 1]);
+                record(&uploaded[i + 1], "H->D", -1, len(i + 1) * sizeof(cl_ulong), 1);
+            }
+            ENQUEUE_READ(transfer_queue_, result, CL_FALSE, 0, len(i) * sizeof(cl_ulong), runs.data() + begin(i),
+                         1, &sorted[i], &downloaded[i]);
+            record(&downloaded[i], "D->H", -1, len(i) * sizeof(cl_ulong), 1);
+            clFlush(transfer_queue_);
+        }
+        check(clFinish(transfer_queue_), "clFinish");
+    } catch (...) {
+        // commands already queued still write to the pooled buffers and runs
+        clFinish(queue_);
+        clFinish(transfer_queue_);
+        release_events();
+        throw;
+    }
+    release_events();
+
+    std::vector<std::pair<const uint64_t*, size_t>> parts;
+    for (size_t i = 0; i < num_chunks; ++i) parts.push_back({runs.data() + begin(i), len(i)});
+    kway_merge(parts, out);
+}
+
+// Where an enqueue should write its event: the caller's slot when it needs
+// the event, a scratch slot when only the profile does, otherwise nowhere
+cl_event* OpenCLSorter::event_slot(cl_event* want) {
+    if (want) return want;
+    return cfg_.profile ? &profile_event_ : nullptr;
+}
+
+// Keeps the event of a just-enqueued command for profile(); an event the
+// caller also holds is retained so both can release it
+void OpenCLSorter::record(cl_event* ev, const char* phase, int pass, uint64_t bytes, int queue) {
+    if (!cfg_.profile || !ev || !*ev) return;
+    if (ev != &profile_event_) clRetainEvent(*ev);
+    pending_.push_back({*ev, phase, pass, bytes, queue});
+    profile_event_ = nullptr;
+}
+
+// Read+write bandwidth of a device-side copy, the practical ceiling for the
+// memory-bound kernels
+double OpenCLSorter::measure_peak_GBps() {
+    size_t bytes = std::min<size_t>(64 << 20, max_alloc_ / 2);
+    cl_int err;
+    cl_mem a = clCreateBuffer(ctx_, CL_MEM_READ_WRITE, bytes, nullptr, &err);
+    check(err, "clCreateBuffer");
+    cl_mem b = clCreateBuffer(ctx_, CL_MEM_READ_WRITE, bytes, nullptr, &err);
+    if (err != CL_SUCCESS) clReleaseMemObject(a);
+    check(err, "clCreateBuffer");
+    double best = 0;
+    for (int r = 0; r < 3; ++r) {  // first copy also pays for first-touch allocation
+        cl_event ev;
+        err = clEnqueueCopyBuffer(queue_, a, b, 0, 0, bytes, 0, nullptr, &ev);
+        if (err != CL_SUCCESS) break;
+        clWaitForEvents(1, &ev);
+        cl_ulong t0 = 0, t1 = 0;
+        clGetEventProfilingInfo(ev, CL_PROFILING_COMMAND_START, sizeof(t0), &t0, nullptr);
+        clGetEventProfilingInfo(ev, CL_PROFILING_COMMAND_END, sizeof(t1), &t1, nullptr);
+        clReleaseEvent(ev);
+        if (t1 > t0) best = std::max(best, 2.0 * bytes / (t1 - t0));  // bytes per ns = GB/s
+    }
+    clReleaseMemObject(a);
+    clReleaseMemObject(b);
+    check(err, "clEnqueueCopyBuffer");
+    return best;
+}
+
+OpenCLProfile OpenCLSorter::profile() {
+    if (!cfg_.profile) throw std::logic_error("OpenCLSorter::profile: profiling is not enabled");
+    check(clFinish(transfer_queue_), "clFinish");
+    check(clFinish(queue_), "clFinish");
+    if (peak_GBps_ == 0) peak_GBps_ = cfg_.peak_GBps > 0 ? cfg_.peak_GBps : measure_peak_GBps();
+
+    OpenCLProfile prof;
+    prof.device = device_name();
+    prof.peak_GBps = peak_GBps_;
+    std::vector<cl_ulong> start(pending_.size()), end(pending_.size());
+    cl_ulong t0 = ~cl_ulong(0);
+    for (size_t i = 0; i < pending_.size(); ++i) {
+        clGetEventProfilingInfo(pending_[i].ev, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &start[i], nullptr);
+        clGetEventProfilingInfo(pending_[i].ev, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &end[i], nullptr);
+        t0 = std::min(t0, start[i]);
+    }
+    for (size_t i = 0; i < pending_.size(); ++i) {
+        const PendingEvent& pe = pending_[i];
+        double sec = (end[i] - start[i]) * 1e-9;
+        prof.commands.push_back({pe.phase, pe.pass, pe.queue, (start[i] - t0) * 1e-3, (end[i] - t0) * 1e-3, pe.bytes});
+        for (auto* agg : {&prof.by_pass, &prof.by_phase}) {
+            int pass = agg == &prof.by_pass ? pe.pass : -1;
+            auto it = std::find_if(agg->begin(), agg->end(), [&](const OpenCLPhaseStats& s) {
+                return s.phase == pe.phase && s.pass == pass;
+            });
+            if (it == agg->end()) {
+                agg->push_back(OpenCLPhaseStats());
+                it = agg->end() - 1;
+                it->phase = pe.phase;
+                it->pass = pass;
+            }
+            it->commands++;
+            it->sec += sec;
+            it->bytes += pe.bytes;
+        }
+        clReleaseEvent(pe.ev);
+    }
+    pending_.clear();
+    return prof;
+}
+
+// s as a quoted JSON string; device names come from the driver and may hold
+// quotes, backslashes or control characters
+static std::string json_string(const std::string& s) {
+    static const char HEX[] = "0123456789abcdef";
+    std::string q = "\"";
+    for (unsigned char c : s) {
+        if (c == '"' || c == '\\') { q += '\\'; q += char(c); }
+        else if (c == '\n') q += "\\n";
+        else if (c == '\t') q += "\\t";
+        else if (c < 0x20) q += std::string("\\u00") + HEX[c >> 4] + HEX[c & 15];
+        else q += char(c);
+    }
+    return q + "\"";
+}
+
+static void phase_json(std::ostringstream& o, const OpenCLPhaseStats& s, double peak) {
+    o << "{\"phase\": " << json_string(s.phase) << ", \"pass\": " << s.pass << ", \"commands\": " << s.commands
+      << ", \"sec\": " << s.sec << ", \"bytes\": " << s.bytes << ", \"GBps\": " << s.GBps()
+      << ", \"fraction_of_peak\": " << (peak > 0 ? s.GBps() / peak : 0) << "}";
+}
+
+std::string OpenCLProfile::to_json() const {
+    std::ostringstream o;
+    o << "{\n  \"device\": " << json_string(device) << ",\n  \"peak_GBps\": " << peak_GBps << ",\n  \"by_phase\": [";
+    for (size_t i = 0; i < by_phase.size(); ++i) {
+        o << (i ? ",\n    " : "\n    ");
+        phase_json(o, by_phase[i], peak_GBps);
+    }
+    o << "\n  ],\n  \"by_pass\": [";
+    for (size_t i = 0; i < by_pass.size(); ++i) {
+        o << (i ? ",\n    " : "\n    ");
+        phase_json(o, by_pass[i], peak_GBps);
+    }
+    o << "\n  ]\n}\n";
+    return o.str();
+}
+
+std::string OpenCLProfile::to_trace() const {
+    std::ostringstream o;
+    o << "{\"traceEvents\": [\n";
+    for (size_t i = 0; i < commands.size(); ++i) {
+        const Command& c = commands[i];
+        o << (i ? ",\n" : "") << "  {\"name\": "
+          << json_string(c.phase + (c.pass >= 0 ? " pass " + std::to_string(c.pass) : ""))
+          << ", \"cat\": " << json_string(c.phase) << ", \"ph\": \"X\", \"pid\": 0, \"tid\": " << c.queue
+          << ", \"ts\": " << c.start_us << ", \"dur\": " << c.end_us - c.start_us
+          << ", \"args\": {\"bytes\": " << c.bytes << "}}";
+    }
+    o << "\n]}\n";
+    return o.str();
+}
+
+OpenCLSortConfig tune_opencl_sort(const OpenCLSortConfig& cfg, size_t keys, int reps, std::ostream* log) {
+    std::vector<OpenCLDevice> devices = opencl_devices();
+    if (cfg.device >= devices.size())
+        throw std::invalid_argument("tune_opencl_sort: device " + std::to_string(cfg.device) + " of " +
+                                    std::to_string(devices.size()));
+    cl_device_id d = devices[cfg.device].id;
+    size_t max_group = 0;
+    clGetDeviceInfo(d, CL_DEVICE_MAX_WORK_GROUP_SIZE, sizeof(max_group), &max_group, nullptr);
+
+    std::vector<uint64_t> input(keys), work(keys);
+    std::mt19937_64 gen(1);
+    for (auto& k : input) k = gen();
+
+    // fastest of reps sorts after a warm-up sort that also builds the kernels;
+    // infinite if the device rejects the settings or sorts wrongly
+    const double NEVER = std::numeric_limits<double>::infinity();
+    auto time = [&](const OpenCLSortConfig& c) {
+        double best = NEVER;
+        try {
+            OpenCLSorter s(c);
+            work = input;
+            s.sort(work.data(), keys);
+            bool sorted = std::is_sorted(work.begin(), work.end());
+            for (int r = 0; sorted && r < reps; ++r) {
+                work = input;
+                auto t0 = std::chrono::steady_clock::now();
+                s.sort(work.data(), keys);
+                best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count());
+            }
+        } catch (const std::exception&) {
+            best = NEVER;
+        }
+        if (log)
+            *log << (c.pipeline == Pipeline::Onesweep ? "onesweep" : c.local_scatter ? "local" : "classic")
+                 << " bits=" << c.bits << " local_size=" << c.local_size << " items=" << c.items
+                 << " scatter_tile=" << c.scatter_tile << ": " << best << " s\n";
+        return best;
+    };
+
+    // Onesweep is not a candidate until its look-back has been tested on
+    // concurrent runtimes (see test_opencl_sort.cpp)
+    OpenCLSortConfig best = cfg;
+    best.pipeline = Pipeline::Classic;
+    best.use_tuned = false;
+    best.verify = Verify::Off;
+    best.profile = false;
+    best.chunk_keys = 0;
+    double best_sec = time(best);
+    auto sweep = [&](auto set, const std::vector<size_t>& values) {
+        for (size_t v : values) {
+            OpenCLSortConfig c = best;
+            set(c, v);
+            if (c.pipeline == best.pipeline && c.local_scatter == best.local_scatter && c.bits == best.bits &&
+                c.local_size == best.local_size && c.items == best.items && c.scatter_tile == best.scatter_tile)
+                continue;  // timed already
+            double t = time(c);
+            if (t < best_sec) {
+                best = c;
+                best_sec = t;
+            }
+        }
+    };
+    sweep([](OpenCLSortConfig& c, size_t v) {
+        c.local_scatter = v == 1;
+        c.scatter_tile = v == 1 ? 4 * c.local_size : 0;
+    }, {0, 1});
+    std::vector<size_t> widths, sizes;
+    for (size_t b = 4; b <= 8; ++b)
+        if ((size_t(1) << b) <= max_group) widths.push_back(b);  // scans run RADIX work-items per group
+    for (size_t v = 64; v <= std::min<size_t>(max_group, 1024); v *= 2) sizes.push_back(v);
+    sweep([](OpenCLSortConfig& c, size_t v) { c.bits = int(v); }, widths);
+    size_t rows = best.scatter_tile / best.local_size;  // keep the tile's rows as the group grows
+    sweep([&](OpenCLSortConfig& c, size_t v) {
+        c.local_size = v;
+        c.scatter_tile = rows * v;
+    }, sizes);
+    sweep([](OpenCLSortConfig& c, size_t v) { c.scatter_tile = v * c.local_size; }, {1, 2, 4, 8, 16});
+    if (best_sec == NEVER) throw std::runtime_error("tune_opencl_sort: no setting sorts on this device");
+
+    OpenCLSortConfig tuned = cfg;
+    tuned.pipeline = best.pipeline;
+    tuned.bits = best.bits;
+    tuned.local_size = best.local_size;
+    tuned.items = best.items;
+    tuned.scatter_tile = best.scatter_tile;
+    tuned.local_scatter = best.local_scatter;
+    if (!cfg.cache_dir.empty()) write_tuned(d, tuned);
+    return tuned;
+}
+
+void run_opencl_radix(const std::vector<uint64_t>& in,
+                      std::vector<uint64_t>&       out,
+                      size_t N,
+                      Verify verify)
+{
+    static OpenCLSorter sorter([] {  // context, program and buffers persist across calls
+        OpenCLSortConfig cfg;
+        cfg.use_tuned = true;
+        return cfg;
+    }());
+
+    // remember what the result must look like before sorting
+    Expected e = expect(in.data(), N, verify);
+
+    out.assign(in.begin(), in.begin() + N);
+    sorter.sort(out.data(), N);
 
     // verify & report
-    if (out != cpu) {
+    if (!matches(e, out.data(), N)) {
       std::cerr << "Mismatch!\n";
       std::exit(1);
     }
@@ -173,6 +1101,4 @@ void run_opencl_radix(const std::vector<uint64_t>& in,
     std::cout << "PASS\n";
     std::cout << "Total H→D bytes: " << total_host_to_device << "\n";
     std::cout << "Total D→H bytes: " << total_device_to_host << "\n";
-
-    // cleanup omitted for brevity...
 }
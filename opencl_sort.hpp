@@ -0,0 +1,220 @@
+#pragma once
+#ifndef CL_TARGET_OPENCL_VERSION
+#define CL_TARGET_OPENCL_VERSION 300
+#endif
+#include <CL/cl.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+// OpenCL LSD radix sort of 64-bit keys. Kernels live in kernels/radix_kernels.cl
+// and are embedded at build time; compiled programs are cached on disk.
+// OpenCL failures are reported as std::runtime_error.
+
+// Off always copies through device buffers; On sorts the caller's memory in
+// place (CL_MEM_USE_HOST_PTR); Auto picks On for CPU and unified-memory devices.
+// Some drivers only avoid the copy for page-aligned host memory.
+enum class ZeroCopy { Off, Auto, On };
+
+// Result checks: Full compares with std::sort of a copy of the input (O(N log N),
+// twice the memory); Fingerprint checks the output is sorted and has the same
+// order-independent multiset hash as the input (O(N), no copy); Off trusts the
+// device.
+enum class Verify { Off, Fingerprint, Full };
+
+// Classic runs histogram, three scan kernels and a scatter per pass, each
+// reading all keys. Onesweep histograms every pass's digits in one read up
+// front and then runs one scatter per pass that chains tile offsets by
+// decoupled look-back (see kernels/radix_kernels.cl); sorts of 2^30 keys or
+// more fall back to Classic. tune_opencl_sort does not pick Onesweep.
+enum class Pipeline { Classic, Onesweep };
+
+// One device of one platform, as listed by opencl_devices()
+struct OpenCLDevice {
+    cl_platform_id platform;
+    cl_device_id id;
+    cl_device_type type;
+    std::string name;
+};
+
+// Every device of every platform, GPUs first, then accelerators, then CPUs
+// (and anything else); platform and driver order within a type
+std::vector<OpenCLDevice> opencl_devices();
+
+struct OpenCLSortConfig {
+    size_t device = 0;                       // index into opencl_devices(): 0 is the preferred device
+    int bits = 8;                            // digit width; 64/bits passes
+    size_t local_size = 256;                 // work-group size of histogram and scatter
+    size_t scan_block = 64;                  // groups per block of the two-level scan
+    Pipeline pipeline = Pipeline::Classic;
+    size_t items = 4;                        // Onesweep keys per work-item; a tile is local_size * items
+    size_t scatter_tile = 0;                 // classic keys per work-group, a multiple of local_size; 0: local_size
+    bool local_scatter = false;              // classic scatter sorts each tile by digit in local memory and
+                                             // writes digit runs contiguously (keys only, not pairs)
+    std::string cache_dir = "opencl_cache";  // compiled program binaries; empty disables
+    size_t chunk_keys = 0;                   // sort_chunked chunk size; 0 sizes it from device memory
+    bool offsets64 = false;                  // classic counts and offsets in 64 bits even when 32 suffice
+    ZeroCopy zero_copy = ZeroCopy::Auto;
+    Verify verify = Verify::Off;             // a failed check throws std::runtime_error
+    bool profile = false;                    // CL_QUEUE_PROFILING_ENABLE; read with OpenCLSorter::profile()
+    double peak_GBps = 0;                    // device memory bandwidth for the profile; 0 measures a copy
+    bool use_tuned = false;                  // replace bits, local_size, items, scatter_tile, local_scatter
+                                             // and pipeline with tune_opencl_sort's settings for the device,
+                                             // when it saved any (the fields set here are then ignored)
+};
+
+// Device time of one phase, from CL_PROFILING_COMMAND_START..END of its commands.
+// Phases: histogram, scan, scatter, segment_ids (kernels), clear (histogram zeroing),
+// copy (device-side copies), H->D, D->H. Kernel bytes are the estimated global
+// memory traffic; transfer bytes are exact.
+struct OpenCLPhaseStats {
+    std::string phase;
+    int pass = -1;                           // radix pass, -1 outside the pass loop or when summed
+    size_t commands = 0;
+    double sec = 0;
+    uint64_t bytes = 0;
+    double GBps() const { return sec > 0 ? bytes / sec / 1e9 : 0; }
+};
+
+struct OpenCLProfile {
+    struct Command {
+        std::string phase;
+        int pass;
+        int queue;                           // 0 compute, 1 transfer
+        double start_us, end_us;             // relative to the first command
+        uint64_t bytes;
+    };
+    std::string device;
+    double peak_GBps = 0;                    // device memory bandwidth the phases are compared against
+    std::vector<OpenCLPhaseStats> by_pass;   // one entry per (phase, pass)
+    std::vector<OpenCLPhaseStats> by_phase;  // summed over passes
+    std::vector<Command> commands;
+
+    std::string to_json() const;             // by_phase and by_pass with GB/s and fraction of peak
+    std::string to_trace() const;            // Chrome trace-event JSON (chrome://tracing, Perfetto)
+};
+
+// Bytes moved by explicit host<->device transfers, across all sorters and threads
+extern std::atomic<uint64_t> total_host_to_device;
+extern std::atomic<uint64_t> total_device_to_host;
+
+// Long-lived sort context: owns the OpenCL context, queue, program, kernels and
+// a pool of device buffers that grows geometrically with the largest sort seen,
+// so repeated sorts pay only transfer and kernel time. Everything is released
+// by the destructor.
+class OpenCLSorter {
+public:
+    explicit OpenCLSorter(const OpenCLSortConfig& cfg = OpenCLSortConfig());
+    ~OpenCLSorter();
+    OpenCLSorter(const OpenCLSorter&) = delete;
+    OpenCLSorter& operator=(const OpenCLSorter&) = delete;
+
+    // Sorts data[0..n) in place. Sorts of 2^32 keys or more use 64-bit
+    // offsets; more keys than fit on the device (device_keys) are sorted in
+    // chunks as by sort_chunked, merging back into data.
+    void sort(uint64_t* data, size_t n);
+
+    // Sorts keys[0..n) and moves values[i] with keys[i]; equal keys keep their
+    // input order. Always copies through device buffers, classic kernels.
+    void sort_pairs(uint64_t* keys, uint32_t* values, size_t n);
+    void sort_pairs(uint64_t* keys, uint64_t* values, size_t n);
+
+    // Sorts each segment keys[offsets[s]..offsets[s+1]) independently, for
+    // all segments in one launch sequence: offsets has one more entry than
+    // there are segments, starts at 0, ends at n and never decreases.
+    // Costs the passes of one sort of n keys plus ceil(log2(segments)/bits).
+    void sort_segments(uint64_t* keys, size_t n, const std::vector<size_t>& offsets);
+
+    // Out-of-core sort of in[0..n) into out (no overlap): device-sized chunks
+    // are streamed with uploads, sorts and downloads overlapped, then merged
+    // on the host
+    void sort_chunked(const uint64_t* in, uint64_t* out, size_t n);
+    size_t chunk_keys() const;
+    size_t device_keys() const;              // most keys sort() handles in one piece
+    size_t tile_keys() const;                // keys per classic work-group
+
+    // Timing of every command since the last call (profiling must be enabled);
+    // waits for queued work
+    OpenCLProfile profile();
+
+    std::string device_name() const;
+    const OpenCLSortConfig& config() const { return cfg_; }  // with tuned settings applied
+    bool tuned() const { return tuned_; }    // settings came from tune_opencl_sort
+    bool zero_copy() const { return zero_copy_; }
+    size_t pooled_bytes() const;             // device memory currently held by the pool
+
+private:
+    struct PooledBuffer { cl_mem mem = nullptr; size_t bytes = 0; };
+    // Onesweep keeps its two tile status arrays in GROUP_HIST and GROUP_OFFSETS
+    // and its all-pass digit offsets and tile counters in DIGIT_OFFSETS;
+    // sort_segments keeps segment ids in VALUES_A/B
+    enum Slot { KEYS_A, KEYS_B, KEYS_C, KEYS_D, VALUES_A, VALUES_B, SEGMENT_OFFSETS,
+                GROUP_HIST, GROUP_OFFSETS, BLOCK_SUMS, DIGIT_OFFSETS, NUM_SLOTS };
+    // One build of the kernel source. Classic counts and offsets are 32-bit in
+    // narrow_ and 64-bit in wide_, which is built on first use.
+    struct Kernels {
+        cl_program prog = nullptr;
+        cl_kernel hist = nullptr, reduce = nullptr, scan = nullptr, offsets = nullptr, scatter = nullptr;
+        cl_kernel scatter_local = nullptr;
+        cl_kernel scatter_kv32 = nullptr, scatter_kv64 = nullptr, segment_ids = nullptr;
+        cl_kernel global_hist = nullptr, pass_scan = nullptr, onesweep = nullptr;
+    };
+
+    cl_mem reserve(Slot s, size_t bytes);
+    void sort_on_device(uint64_t* data, size_t n);
+    void stream_chunks(const uint64_t* in, uint64_t* out, size_t n);
+    void sort_in_place(uint64_t* data, size_t n);
+    cl_mem enqueue_sort(cl_mem keys, cl_mem scratch, size_t n, const std::vector<cl_event>& wait, cl_event* done);
+    void enqueue_classic(cl_mem& keys, cl_mem& scratch, cl_mem& values, cl_mem& value_scratch, size_t value_bytes,
+                         int passes, size_t n, const std::vector<cl_event>& wait, cl_event* done);
+    template <class Offset>
+    void enqueue_passes(cl_mem& keys, cl_mem& scratch, cl_mem& values, cl_mem& value_scratch, size_t value_bytes,
+                        int passes, size_t n, const std::vector<cl_event>& wait, cl_event* done);
+    template <class V> void sort_pairs_on_device(uint64_t* keys, V* values, size_t n);
+    template <class Offset> void sort_segments_on_device(uint64_t* keys, size_t n, const std::vector<size_t>& offsets);
+    bool wide_offsets(size_t n) const;
+    const Kernels& kernels(bool wide);
+    void build_kernels(Kernels& k, const char* offset_type);
+    static void release_kernels(Kernels& k);
+    cl_mem enqueue_onesweep(cl_mem keys, cl_mem scratch, size_t n, const std::vector<cl_event>& wait, cl_event* done);
+    void release();
+    cl_event* event_slot(cl_event* want);
+    void record(cl_event* ev, const char* phase, int pass, uint64_t bytes, int queue);
+    double measure_peak_GBps();
+
+    struct PendingEvent { cl_event ev; const char* phase; int pass; uint64_t bytes; int queue; };
+
+    OpenCLSortConfig cfg_;
+    cl_device_id device_ = nullptr;
+    cl_context ctx_ = nullptr;
+    cl_command_queue queue_ = nullptr;           // kernels
+    cl_command_queue transfer_queue_ = nullptr;  // sort_chunked uploads and downloads
+    Kernels narrow_, wide_;
+    size_t max_alloc_ = 0;
+    cl_uint compute_units_ = 1;
+    bool zero_copy_ = false;
+    bool tuned_ = false;
+    PooledBuffer pool_[NUM_SLOTS];
+    std::vector<PendingEvent> pending_;      // profiled commands not yet collected
+    cl_event profile_event_ = nullptr;
+    double peak_GBps_ = 0;
+};
+
+// Times sorts of `keys` random keys on cfg's device while sweeping, one
+// parameter at a time and keeping the fastest so far: classic scatter or
+// local_scatter, digit width, work-group size, then tile size. The pipeline
+// is always Classic. Settings the device rejects are skipped. The winner is
+// saved in cache_dir for the device (name and driver version), where later
+// OpenCLSorters with use_tuned find it, and returned applied to cfg. Each
+// trial is written to log, if given.
+OpenCLSortConfig tune_opencl_sort(const OpenCLSortConfig& cfg, size_t keys = size_t(1) << 22, int reps = 3,
+                                  std::ostream* log = nullptr);
+
+// One-shot helper: sorts in[0..N) into out on a process-wide OpenCLSorter
+// with the device's tuned settings, checks the result (exits on a mismatch) and prints the bytes moved between
+// host and device.
+void run_opencl_radix(const std::vector<uint64_t>& in, std::vector<uint64_t>& out, size_t N,
+                      Verify verify = Verify::Fingerprint);
@@ -1,4 +1,5 @@
 #include "radix_sort.hpp"
+#include "util.hpp"
 #include <algorithm>
 #include <vector>
 #include <utility>
@@ -56,14 +57,54 @@ void radix_sort_single_inplace(T* data, size_t N) {
 
 }
 
-// Multi-threaded Radix Sort (LSD or MSD) skeleton
-// TODO: implement parallel histogram, prefix, and scatter phases
+// Multi-threaded LSB-based Radix Sort
+// Same digit schedule as radix_sort_single_lsb; each pass runs
+// 1) per-thread histograms over a contiguous slice of the input
+// 2) a serial prefix over (bucket, thread) giving each thread its write offsets
+// 3) a parallel, stable scatter into dst using those offsets
 template <typename T>
 void radix_sort_multi_threaded(T* in, T* out, size_t N, size_t threads) {
-    // 1) Partition input among threads to compute local histograms
-    // 2) Merge local histograms into global offsets
-    // 3) Parallel scatter into out[] using the computed offsets
-    std::move(in, in + N, out);
+    constexpr unsigned BITS = 11;
+    constexpr unsigned BUCKETS = 1u << BITS;
+    constexpr unsigned PASSES = (sizeof(T) * 8 + BITS - 1) / BITS;
+
+    if (threads <= 1 || N < threads * BUCKETS) {
+        radix_sort_single_lsb(in, out, N);
+        return;
+    }
+
+    std::vector<std::vector<size_t>> hist(threads, std::vector<size_t>(BUCKETS));
+    std::vector<size_t> begin(threads + 1);
+    for (size_t t = 0; t <= threads; ++t) begin[t] = N * t / threads;
+    T* src = in;
+    T* dst = out;
+
+    for (unsigned pass = 0; pass < PASSES; ++pass) {
+        unsigned shift = pass * BITS;
+        parallel(threads, [&](size_t t) {
+            auto& h = hist[t];
+            std::fill(h.begin(), h.end(), 0);
+            for (size_t i = begin[t]; i < begin[t + 1]; ++i)
+                ++h[(src[i] >> shift) & (BUCKETS - 1)];
+        });
+        size_t sum = 0;
+        for (unsigned b = 0; b < BUCKETS; ++b) {
+            for (size_t t = 0; t < threads; ++t) {
+                size_t c = hist[t][b];
+                hist[t][b] = sum;
+                sum += c;
+            }
+        }
+        parallel(threads, [&](size_t t) {
+            auto& off = hist[t];
+            for (size_t i = begin[t]; i < begin[t + 1]; ++i)
+                dst[off[(src[i] >> shift) & (BUCKETS - 1)]++] = src[i];
+        });
+        std::swap(src, dst);
+    }
+    if (src != out) {
+        std::copy(src, src + N, out);
+    }
 }
 
 // NUMA/Chiplet-aware optimizations
@@ -0,0 +1,22 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Radix sort variants for 64-bit keys.
+// All variants may use `in` as scratch space; the sorted result is in `out`.
+
+// Single-threaded LSB-based Radix Sort
+template <typename T>
+void radix_sort_single_lsb(T* in, T* out, size_t N);
+
+// Single-threaded MSD-based Radix Sort (skeleton)
+template <typename T>
+void radix_sort_single_msb(T* in, T* out, size_t N);
+
+// In-place Radix Sort (skeleton)
+template <typename T>
+void radix_sort_single_inplace(T* data, size_t N);
+
+// Multi-threaded LSB-based Radix Sort
+template <typename T>
+void radix_sort_multi_threaded(T* in, T* out, size_t N, size_t threads);
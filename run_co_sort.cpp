@@ -0,0 +1,73 @@
+// run_co_sort.cpp
+// Sorts batches of random 64-bit keys with CoSorter (OpenCL device and host
+// cores together) and prints how each batch was split and how long each side
+// took, then the time of radix_sort_multi_threaded alone on the same batch
+// size for reference. skew > 0 draws keys with that many leading zero bits
+// more often, to exercise the MSD split.
+//
+// Build: (echo 'R"CLC('; cat kernels/radix_kernels.cl; echo ')CLC"') > radix_kernels.cl.inc
+//        g++ -O2 -std=c++17 -pthread run_co_sort.cpp co_sort.cpp opencl_sort.cpp radix_sort.cpp kway_merge.cpp -lOpenCL -o run_co_sort
+// Usage: ./run_co_sort [keys=4194304] [batches=5] [cpu_threads=0] [device_share=0.5] [skew=0]
+
+#include "co_sort.hpp"
+#include "radix_sort.hpp"
+#include "util.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+int main(int argc, char** argv) {
+    size_t n = argc > 1 ? strtoull(argv[1], nullptr, 10) : 1 << 22;
+    int batches = argc > 2 ? atoi(argv[2]) : 5;
+    CoSortConfig cfg;
+    cfg.cpu_threads = argc > 3 ? strtoull(argv[3], nullptr, 10) : 0;
+    cfg.device_share = argc > 4 ? atof(argv[4]) : 0.5;
+    cfg.device.use_tuned = true;
+    int skew = argc > 5 ? atoi(argv[5]) : 0;
+
+    mt19937_64 gen(7);
+    auto draw = [&] { return skew > 0 && gen() % 2 ? gen() >> skew : gen(); };
+    vector<uint64_t> keys(n), check;
+    try {
+        CoSorter sorter(cfg);
+        cout << "CoSorter on " << sorter.device().device_name() << "\n";
+        for (int b = 0; b < batches; ++b) {
+            for (auto& k : keys) k = draw();
+            check = keys;
+            double share = sorter.device_share();
+            double t0 = now_sec();
+            sorter.sort(keys.data(), n);
+            double t = now_sec() - t0;
+            const CoSortStats& s = sorter.last();
+            sort(check.begin(), check.end());
+            if (keys != check) {
+                cerr << "batch " << b << ": mismatch\n";
+                return 1;
+            }
+            cout << "batch " << b << ": " << n << " keys in " << t << " s (" << n * sizeof(uint64_t) / 1048576.0 / t
+                 << " MB/s), share " << share << ": device " << s.device_keys << " keys in " << s.device_sec
+                 << " s, cpu " << s.cpu_keys << " keys in " << s.cpu_sec << " s, "
+                 << (s.merged ? "merge " : "partition ") << s.partition_sec << " s\n";
+        }
+    } catch (const exception& e) {
+        cerr << e.what() << "\n";
+        return 1;
+    }
+
+    size_t threads = cfg.cpu_threads ? cfg.cpu_threads : max(1u, thread::hardware_concurrency());
+    vector<uint64_t> out(n);
+    for (auto& k : keys) k = draw();
+    double t0 = now_sec();
+    radix_sort_multi_threaded(keys.data(), out.data(), n, threads);
+    double t = now_sec() - t0;
+    cout << "radix_sort_multi_threaded alone (" << threads << " threads): " << t << " s ("
+         << n * sizeof(uint64_t) / 1048576.0 / t << " MB/s)\n";
+    return 0;
+}
@@ -0,0 +1,36 @@
+#include "run_codec.hpp"
+
+size_t encode_sorted_run(const uint64_t* in, size_t n, std::vector<uint8_t>& out) {
+    size_t start = out.size();
+    out.reserve(start + n * 2);
+    uint64_t prev = 0;
+    for (size_t i = 0; i < n; ++i) {
+        uint64_t d = in[i] - prev;
+        prev = in[i];
+        while (d >= 0x80) {
+            out.push_back(uint8_t(d) | 0x80);
+            d >>= 7;
+        }
+        out.push_back(uint8_t(d));
+    }
+    return out.size() - start;
+}
+
+size_t decode_sorted_run(const uint8_t* in, size_t bytes, uint64_t* out) {
+    const uint8_t* end = in + bytes;
+    uint64_t prev = 0;
+    size_t n = 0;
+    while (in < end) {
+        uint64_t d = 0;
+        unsigned shift = 0;
+        uint8_t b;
+        do {
+            b = *in++;
+            d |= uint64_t(b & 0x7f) << shift;
+            shift += 7;
+        } while (b & 0x80);
+        prev += d;
+        out[n++] = prev;
+    }
+    return n;
+}
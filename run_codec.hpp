@@ -0,0 +1,14 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Compression for sorted runs of uint64_t keys: each key is stored as the
+// LEB128 varint of its delta to the previous key, so dense key ranges shrink
+// to a few bytes per key. Input to encode_sorted_run must be sorted.
+
+// Appends the encoding of in[0..n) to out; returns encoded bytes
+size_t encode_sorted_run(const uint64_t* in, size_t n, std::vector<uint8_t>& out);
+
+// Decodes `bytes` bytes of one encoded run into out; returns number of keys
+size_t decode_sorted_run(const uint8_t* in, size_t bytes, uint64_t* out);
@@ -0,0 +1,73 @@
+// run_local_sort.cpp
+// Runs the real external sort engine against the local object-store stand-in,
+// shaped with the same parameters external_sort_sim uses for its ObjectStore.
+//
+// Build: g++ -O2 -std=c++17 -pthread run_local_sort.cpp external_sort.cpp local_object_store.cpp radix_sort.cpp -o run_local_sort
+// Usage: ./run_local_sort [dataset_MB=256] [run_MB=64] [fanin=4] [store_dir=local_store]
+
+#include "external_sort.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+int main(int argc, char** argv) {
+    double dataset_MB = argc > 1 ? atof(argv[1]) : 256;
+    ExternalSortConfig cfg;
+    cfg.run_MB = argc > 2 ? atof(argv[2]) : 64;
+    cfg.fanin = argc > 3 ? atoi(argv[3]) : 4;
+    string dir = argc > 4 ? argv[4] : "local_store";
+
+    // Same figures as the simulator's default "s3" store, with a request budget
+    StoreShaping s3;
+    s3.latency_ms = 50;
+    s3.mean_throughput_MBps = 100;
+    s3.throughput_jitter = 0.2;
+    s3.cost_per_GB = 0.023;
+    s3.cost_per_request = 0.000005;
+    s3.chunk_size_MB = 64;
+    s3.max_requests_per_sec = 3500;
+    cfg.buffer_MB = s3.chunk_size_MB;
+
+    // upload unshaped input, then shape the sort itself
+    LocalObjectStore store(dir, s3);
+    vector<uint64_t> keys(size_t(dataset_MB * 1024 * 1024 / sizeof(uint64_t)));
+    mt19937_64 gen(7);
+    for (auto& k : keys) k = gen();
+    {
+        LocalObjectStore loader(dir, StoreShaping());
+        loader.put("input", keys.data(), keys.size() * sizeof(uint64_t));
+    }
+
+    ExternalSortEngine engine(store, cfg);
+    auto phases = engine.sort("input", "output");
+
+    vector<char> raw = store.get("output");
+    const uint64_t* out = reinterpret_cast<const uint64_t*>(raw.data());
+    size_t n = raw.size() / sizeof(uint64_t);
+    sort(keys.begin(), keys.end());
+    if (n != keys.size() || !equal(keys.begin(), keys.end(), out)) {
+        cerr << "Output is not a sorted permutation of the input\n";
+        return 1;
+    }
+
+    cout << fixed << setprecision(3);
+    double total_t = 0, total_c = 0;
+    for (auto& p : phases) {
+        cout << p.name << ": " << p.wall_sec << " s (compute " << p.compute_sec << " s), "
+             << p.runs_in << " -> " << p.runs_out << " runs, "
+             << p.store.get_requests << " GET / " << p.store.put_requests << " PUT / " << p.store.head_requests << " HEAD, "
+             << p.store.bytes_read / 1048576.0 << " MB read / " << p.store.bytes_written / 1048576.0 << " MB written, "
+             << p.store.throttled << " throttled, $" << setprecision(6) << p.store.cost << setprecision(3) << "\n";
+        total_t += p.wall_sec;
+        total_c += p.store.cost;
+    }
+    cout << "Total time: " << total_t << " seconds\n";
+    cout << "Total store cost: $" << setprecision(6) << total_c << "\n";
+    return 0;
+}
@@ -0,0 +1,120 @@
+// run_opencl_sort.cpp
+// Sorts batches of random 64-bit keys on one long-lived OpenCLSorter and
+// reports setup time and per-batch wall time. Runs on any OpenCL runtime,
+// including CPU ones such as PoCL. With chunk_keys > 0 the batch is streamed
+// through the device in chunks of that size and merged on the host.
+// zero_copy is off, auto or on (sort in place on host memory, see ZeroCopy);
+// verify is off, fingerprint or full (see Verify) and is included in the time.
+// pipeline is tuned (the settings tune_opencl_sort saved for the device, or
+// the defaults), classic, local (classic with the local-memory scatter over
+// tiles of 4 * local_size keys), onesweep or compare (the last three on the
+// same batches, then the mean time of each; see Pipeline). With a profile prefix the queues are
+// profiled and <prefix>.json (per-phase and per-pass device time and GB/s)
+// and <prefix>.trace.json (Chrome trace) are written after the batches
+// (<prefix>.<pipeline>.json when comparing).
+//
+// Build: (echo 'R"CLC('; cat kernels/radix_kernels.cl; echo ')CLC"') > radix_kernels.cl.inc
+//        g++ -O2 -std=c++17 run_opencl_sort.cpp opencl_sort.cpp kway_merge.cpp -lOpenCL -o run_opencl_sort
+// Usage: ./run_opencl_sort [keys=1048576] [batches=3] [chunk_keys=0] [zero_copy=auto] [verify=fingerprint]
+//                          [pipeline=tuned] [profile]
+
+#include "opencl_sort.hpp"
+#include "util.hpp"
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+int main(int argc, char** argv) {
+    size_t n = argc > 1 ? strtoull(argv[1], nullptr, 10) : 1 << 20;
+    int batches = argc > 2 ? atoi(argv[2]) : 3;
+    OpenCLSortConfig cfg;
+    cfg.chunk_keys = argc > 3 ? strtoull(argv[3], nullptr, 10) : 0;
+    string zc = argc > 4 ? argv[4] : "auto";
+    cfg.zero_copy = zc == "on" ? ZeroCopy::On : zc == "off" ? ZeroCopy::Off : ZeroCopy::Auto;
+    string vf = argc > 5 ? argv[5] : "fingerprint";
+    cfg.verify = vf == "off" ? Verify::Off : vf == "full" ? Verify::Full : Verify::Fingerprint;
+    string pl = argc > 6 ? argv[6] : "tuned";
+    string prof = argc > 7 ? argv[7] : "";
+    cfg.profile = !prof.empty();
+
+    vector<pair<string, Pipeline>> pipelines;
+    if (pl == "tuned") pipelines.push_back({"tuned", cfg.pipeline});
+    for (auto& p : {make_pair(string("classic"), Pipeline::Classic), make_pair(string("local"), Pipeline::Classic),
+                    make_pair(string("onesweep"), Pipeline::Onesweep)})
+        if (pl == p.first || pl == "compare") pipelines.push_back(p);
+    if (pipelines.empty()) {
+        cerr << "unknown pipeline " << pl << "\n";
+        return 1;
+    }
+    vector<double> mean_sec;
+
+    for (auto& [name, pipeline] : pipelines) {
+        cfg.use_tuned = name == "tuned";
+        cfg.pipeline = pipeline;
+        cfg.local_scatter = name == "local";
+        cfg.scatter_tile = cfg.local_scatter ? 4 * cfg.local_size : 0;
+        double t0 = now_sec();
+        OpenCLSorter sorter(cfg);
+        cout << "OpenCL setup on " << sorter.device_name() << " (" << name << "): " << now_sec() - t0 << " s"
+             << (sorter.zero_copy() ? " (zero-copy)" : "") << "\n";
+        if (sorter.tuned()) {
+            const OpenCLSortConfig& c = sorter.config();
+            cout << "tuned: " << (c.pipeline == Pipeline::Onesweep ? "onesweep" : c.local_scatter ? "local" : "classic")
+                 << " bits=" << c.bits << " local_size=" << c.local_size << " items=" << c.items
+                 << " scatter_tile=" << c.scatter_tile << "\n";
+        }
+
+        mt19937_64 gen(7);
+        vector<uint64_t> keys(n), out(n);
+        uint64_t h2d0 = total_host_to_device, d2h0 = total_device_to_host;
+        double total = 0;
+        for (int b = 0; b < batches; ++b) {
+            for (auto& k : keys) k = gen();
+            t0 = now_sec();
+            try {
+                if (cfg.chunk_keys) sorter.sort_chunked(keys.data(), out.data(), n);
+                else sorter.sort(keys.data(), n);
+            } catch (const exception& e) {
+                cerr << "batch " << b << ": " << e.what() << "\n";
+                return 1;
+            }
+            double t = now_sec() - t0;
+            total += t;
+            uint64_t h2d = total_host_to_device, d2h = total_device_to_host;
+            cout << "batch " << b << ": " << n << " keys in " << t << " s ("
+                 << n * sizeof(uint64_t) / 1048576.0 / t << " MB/s), pool " << sorter.pooled_bytes() / 1048576.0 << " MB"
+                 << ", H->D " << h2d - h2d0 << " B, D->H " << d2h - d2h0 << " B\n";
+            h2d0 = h2d;
+            d2h0 = d2h;
+        }
+        mean_sec.push_back(batches > 0 ? total / batches : 0);
+
+        if (cfg.profile) {
+            OpenCLProfile p = sorter.profile();
+            string path = pipelines.size() > 1 ? prof + "." + name : prof;
+            ofstream(path + ".json") << p.to_json();
+            ofstream(path + ".trace.json") << p.to_trace();
+            cout << "profile (peak " << p.peak_GBps << " GB/s):\n";
+            for (auto& s : p.by_phase)
+                cout << "  " << s.phase << ": " << s.commands << " commands, " << s.sec * 1e3 << " ms, "
+                     << s.GBps() << " GB/s\n";
+        }
+    }
+
+    if (pipelines.size() > 1) {
+        cout << "mean per batch:";
+        for (size_t i = 0; i < pipelines.size(); ++i)
+            cout << (i ? ", " : " ") << pipelines[i].first << " " << mean_sec[i] << " s ("
+                 << mean_sec[0] / mean_sec[i] << "x)";
+        cout << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,279 @@
+// test_opencl_sort.cpp
+// Correctness test of the OpenCL sorts on one device, by default the first CPU
+// device (a CPU ICD such as PoCL runs several work-groups at once, so it also
+// exercises the kernels' cross-group synchronisation). Every mode is compared
+// with std::sort, or std::stable_sort for key-value pairs: classic and local
+// scatter at several digit widths and tile sizes, Onesweep, 64-bit offsets,
+// pairs with 32- and 64-bit values, segments, chunked streaming, zero-copy,
+// the CPU+device co-sort and a multi-device sort over the same device three
+// times. Inputs are random, duplicate-heavy, presorted and all-equal keys.
+// Onesweep's decoupled look-back is repeated with small tiles, so it only
+// means something on a runtime that runs work-groups concurrently (PoCL, a
+// GPU); it must pass there before tune_opencl_sort may pick Onesweep.
+// Prints one line per case; exits 1 if any case fails and 77 (skipped) when
+// there is no OpenCL device.
+//
+// Build (only where OpenCL is installed):
+//        (echo 'R"CLC('; cat kernels/radix_kernels.cl; echo ')CLC"') > radix_kernels.cl.inc
+//        pkg-config --exists OpenCL && g++ -O2 -std=c++17 -pthread test_opencl_sort.cpp opencl_sort.cpp co_sort.cpp multi_sort.cpp radix_sort.cpp kway_merge.cpp -lOpenCL -o test_opencl_sort
+// Usage: ./test_opencl_sort [keys=100000] [device=first CPU device]
+
+#include "co_sort.hpp"
+#include "multi_sort.hpp"
+#include "opencl_sort.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+static int failures = 0;
+
+// Runs one case; a thrown exception counts as a failure
+static void check_case(const string& name, const function<bool()>& body) {
+    bool ok = false;
+    string why;
+    try {
+        ok = body();
+    } catch (const exception& e) {
+        why = string(": ") + e.what();
+    }
+    cout << (ok ? "ok   " : "FAIL ") << name << why << "\n";
+    if (!ok) ++failures;
+}
+
+// n keys of one shape: random, few distinct values, already sorted, all equal
+static vector<uint64_t> make_keys(size_t n, int shape, uint64_t seed) {
+    mt19937_64 gen(seed);
+    vector<uint64_t> k(n);
+    for (auto& x : k) x = shape == 1 ? gen() % 16 << 40 : shape == 3 ? 0x5a5a5a5a5a5a5a5aull : gen();
+    if (shape == 2) sort(k.begin(), k.end());
+    return k;
+}
+static const char* SHAPES[] = {"random", "few-distinct", "presorted", "all-equal"};
+
+static bool sorts(OpenCLSorter& s, vector<uint64_t> keys) {
+    vector<uint64_t> want = keys;
+    sort(want.begin(), want.end());
+    s.sort(keys.data(), keys.size());
+    return keys == want;
+}
+
+template <class V>
+static bool sorts_pairs(OpenCLSorter& s, vector<uint64_t> keys) {
+    vector<V> values(keys.size());
+    for (size_t i = 0; i < values.size(); ++i) values[i] = V(i * 0x9e3779b97f4a7c15ull);
+    vector<pair<uint64_t, V>> want(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) want[i] = {keys[i], values[i]};
+    stable_sort(want.begin(), want.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+    s.sort_pairs(keys.data(), values.data(), keys.size());
+    for (size_t i = 0; i < keys.size(); ++i)
+        if (keys[i] != want[i].first || values[i] != want[i].second) return false;
+    return true;
+}
+
+static bool sorts_segments(OpenCLSorter& s, vector<uint64_t> keys, uint64_t seed) {
+    mt19937_64 gen(seed);
+    vector<size_t> offsets{0};
+    while (offsets.back() < keys.size()) {  // empty, single-key and long segments
+        size_t len = gen() % 4 == 0 ? gen() % 2 : gen() % (keys.size() / 8 + 1);
+        offsets.push_back(min(keys.size(), offsets.back() + len));
+    }
+    vector<uint64_t> want = keys;
+    for (size_t i = 0; i + 1 < offsets.size(); ++i) sort(want.begin() + offsets[i], want.begin() + offsets[i + 1]);
+    s.sort_segments(keys.data(), keys.size(), offsets);
+    return keys == want;
+}
+
+static bool sorts_chunked(OpenCLSorter& s, const vector<uint64_t>& keys) {
+    vector<uint64_t> want = keys, out(keys.size());
+    sort(want.begin(), want.end());
+    s.sort_chunked(keys.data(), out.data(), keys.size());
+    return out == want;
+}
+
+// Every case on one device; a sorter that cannot be set up throws
+static void run_cases(size_t n, size_t device) {
+    OpenCLSortConfig base;
+    base.device = device;
+    base.use_tuned = false;
+    base.zero_copy = ZeroCopy::Off;
+    const size_t sizes[] = {0, 1, 1000, 4097, n};
+
+    // plain sorts: every size and key shape per kernel configuration
+    struct Kernel { string name; int bits; size_t local_size, tile; bool local_scatter; Pipeline pipeline; };
+    const vector<Kernel> kernels = {
+        {"classic bits=4", 4, 64, 0, false, Pipeline::Classic},
+        {"classic bits=5", 5, 64, 0, false, Pipeline::Classic},
+        {"classic bits=7", 7, 128, 0, false, Pipeline::Classic},
+        {"classic bits=8", 8, 256, 0, false, Pipeline::Classic},
+        {"classic bits=8 tile=3x", 8, 64, 192, false, Pipeline::Classic},
+        {"local bits=8 tile=1x", 8, 256, 256, true, Pipeline::Classic},
+        {"local bits=6 tile=3x", 6, 64, 192, true, Pipeline::Classic},
+        {"local bits=8 tile=4x", 8, 64, 256, true, Pipeline::Classic},
+        {"onesweep bits=8", 8, 256, 0, false, Pipeline::Onesweep},
+    };
+    for (const Kernel& k : kernels)
+        for (bool wide : {false, true}) {
+            if (wide && k.pipeline == Pipeline::Onesweep) continue;  // Onesweep has 32-bit offsets only
+            OpenCLSortConfig c = base;
+            c.bits = k.bits;
+            c.local_size = k.local_size;
+            c.scatter_tile = k.tile;
+            c.local_scatter = k.local_scatter;
+            c.pipeline = k.pipeline;
+            c.offsets64 = wide;
+            unique_ptr<OpenCLSorter> s;
+            string name = k.name + (wide ? " offsets64" : "");
+            try {
+                s = make_unique<OpenCLSorter>(c);
+            } catch (const exception& e) {
+                cout << "FAIL " << name << ": " << e.what() << "\n";
+                ++failures;
+                continue;
+            }
+            for (size_t len : sizes)
+                for (int shape = 0; shape < 4; ++shape)
+                    check_case(name + ", " + to_string(len) + " " + SHAPES[shape] + " keys",
+                               [&] { return sorts(*s, make_keys(len, shape, len + shape)); });
+        }
+
+    // Onesweep look-back under contention: 64-key tiles give far more tiles
+    // than work-groups in flight, so tiles regularly find a predecessor that
+    // has published its counts but not yet its inclusive prefix and must add
+    // that aggregate and keep walking back. Repeats vary the interleaving.
+    for (int bits : {5, 8})
+        for (size_t items : {1, 4}) {
+            OpenCLSortConfig c = base;
+            c.pipeline = Pipeline::Onesweep;
+            c.bits = bits;
+            c.local_size = 64;
+            c.items = items;
+            OpenCLSorter s(c);
+            for (int rep = 0; rep < 5; ++rep)
+                for (int shape : {0, 1})
+                    check_case("onesweep look-back bits=" + to_string(bits) + " items=" + to_string(items) + " run " +
+                                   to_string(rep) + ", " + to_string(n) + " " + SHAPES[shape] + " keys",
+                               [&] { return sorts(s, make_keys(n, shape, 71 + rep)); });
+        }
+
+    // pairs and segments use the classic scatter, at both offset widths
+    for (int bits : {5, 8})
+        for (bool wide : {false, true}) {
+            OpenCLSortConfig c = base;
+            c.bits = bits;
+            c.offsets64 = wide;
+            OpenCLSorter s(c);
+            string name = "bits=" + to_string(bits) + (wide ? " offsets64" : "");
+            for (int shape = 0; shape < 4; ++shape) {
+                string what = string(", ") + to_string(n) + " " + SHAPES[shape] + " keys";
+                check_case("pairs u32 " + name + what, [&] { return sorts_pairs<uint32_t>(s, make_keys(n, shape, 11)); });
+                check_case("pairs u64 " + name + what, [&] { return sorts_pairs<uint64_t>(s, make_keys(n, shape, 12)); });
+                check_case("segments " + name + what,
+                           [&] { return sorts_segments(s, make_keys(n, shape, 13), shape); });
+            }
+        }
+
+    // streaming in chunks, with and without overlapping uploads
+    {
+        OpenCLSortConfig c = base;
+        c.chunk_keys = n / 5 + 3;
+        OpenCLSorter s(c);
+        for (int shape = 0; shape < 4; ++shape)
+            check_case(string("chunked, ") + to_string(n) + " " + SHAPES[shape] + " keys",
+                       [&] { return sorts_chunked(s, make_keys(n, shape, 21)); });
+        check_case("chunked, one chunk", [&] { return sorts_chunked(s, make_keys(n / 10, 0, 22)); });
+    }
+
+    // zero-copy on the caller's memory, both pass parities
+    for (int bits : {5, 8}) {
+        OpenCLSortConfig c = base;
+        c.bits = bits;
+        c.zero_copy = ZeroCopy::On;
+        OpenCLSorter s(c);
+        for (int shape = 0; shape < 4; ++shape)
+            check_case("zero-copy bits=" + to_string(bits) + ", " + to_string(n) + " " + SHAPES[shape] + " keys",
+                       [&] { return sorts(s, make_keys(n, shape, 31)); });
+    }
+
+    // built-in verification passes on correct results
+    for (Verify v : {Verify::Fingerprint, Verify::Full}) {
+        OpenCLSortConfig c = base;
+        c.verify = v;
+        OpenCLSorter s(c);
+        check_case(string("verify ") + (v == Verify::Full ? "full" : "fingerprint"),
+                   [&] { return sorts(s, make_keys(n, 0, 41)); });
+    }
+
+    // device and host cores together; skewed keys force the merge fallback
+    {
+        CoSortConfig c;
+        c.device = base;
+        CoSorter s(c);
+        for (int shape = 0; shape < 4; ++shape)
+            check_case(string("co-sort, ") + to_string(n) + " " + SHAPES[shape] + " keys", [&] {
+                vector<uint64_t> keys = make_keys(n, shape, 51), want = keys;
+                sort(want.begin(), want.end());
+                s.sort(keys.data(), n);
+                return keys == want;
+            });
+    }
+
+    // one device three times stands in for three devices
+    {
+        MultiSortConfig c;
+        c.device = base;
+        c.devices = {device, device, device};
+        MultiSorter s(c);
+        for (int batch = 0; batch < 2; ++batch)
+            for (int shape = 0; shape < 4; ++shape)
+                check_case("multi-device batch " + to_string(batch) + ", " + to_string(n) + " " + SHAPES[shape] + " keys",
+                           [&] {
+                               vector<uint64_t> keys = make_keys(n, shape, 61 + batch), want = keys;
+                               sort(want.begin(), want.end());
+                               s.sort(keys.data(), n);
+                               return keys == want;
+                           });
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t n = argc > 1 ? strtoull(argv[1], nullptr, 10) : 100000;
+    vector<OpenCLDevice> all;
+    try {
+        all = opencl_devices();
+    } catch (const exception& e) {
+        cout << "skipped: " << e.what() << "\n";
+        return 77;
+    }
+    if (all.empty()) {
+        cout << "skipped: no OpenCL device\n";
+        return 77;
+    }
+    size_t device = 0;
+    while (device < all.size() && !(all[device].type & CL_DEVICE_TYPE_CPU)) ++device;
+    if (device == all.size()) device = 0;
+    if (argc > 2) device = strtoull(argv[2], nullptr, 10);
+    if (device >= all.size()) {
+        cerr << "device " << device << " of " << all.size() << "\n";
+        return 1;
+    }
+    cout << "device " << device << ": " << all[device].name << ", " << n << " keys\n";
+
+    try {
+        run_cases(n, device);
+    } catch (const exception& e) {
+        cout << "FAIL " << e.what() << "\n";
+        ++failures;
+    }
+    cout << (failures ? to_string(failures) + " failed\n" : "all passed\n");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,42 @@
+// tune_opencl_sort.cpp
+// Finds the fastest OpenCL sort settings for one device with tune_opencl_sort
+// (classic or local scatter, digit width, work-group size, tile size)
+// and saves them in the cache directory, where later OpenCLSorters on that
+// device and driver with use_tuned pick them up (run_opencl_sort,
+// run_multi_sort, run_co_sort and run_opencl_radix do). Lists the devices first; device is
+// an index into that list. Each trial's time is printed as it runs.
+//
+// Build: (echo 'R"CLC('; cat kernels/radix_kernels.cl; echo ')CLC"') > radix_kernels.cl.inc
+//        g++ -O2 -std=c++17 tune_opencl_sort.cpp opencl_sort.cpp kway_merge.cpp -lOpenCL -o tune_opencl_sort
+// Usage: ./tune_opencl_sort [keys=4194304] [reps=3] [device=0] [cache_dir=opencl_cache]
+
+#include "opencl_sort.hpp"
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+int main(int argc, char** argv) {
+    size_t n = argc > 1 ? strtoull(argv[1], nullptr, 10) : 1 << 22;
+    int reps = argc > 2 ? atoi(argv[2]) : 3;
+    OpenCLSortConfig cfg;
+    cfg.device = argc > 3 ? strtoull(argv[3], nullptr, 10) : 0;
+    if (argc > 4) cfg.cache_dir = argv[4];
+
+    vector<OpenCLDevice> all = opencl_devices();
+    for (size_t i = 0; i < all.size(); ++i) cout << "device " << i << ": " << all[i].name << "\n";
+    try {
+        OpenCLSortConfig c = tune_opencl_sort(cfg, n, reps, &cout);
+        cout << "best: " << (c.local_scatter ? "local" : "classic")
+             << " bits=" << c.bits << " local_size=" << c.local_size << " scatter_tile=" << c.scatter_tile << (cfg.cache_dir.empty() ? "" : ", saved in " + cfg.cache_dir)
+             << "\n";
+    } catch (const exception& e) {
+        cerr << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
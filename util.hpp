@@ -0,0 +1,19 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// Monotonic wall clock in seconds, for timing phases and batches
+inline double now_sec() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Runs body(t) for t in [0, threads) on one thread each and waits for all of them
+template <typename Body>
+void parallel(size_t threads, Body&& body) {
+    std::vector<std::thread> pool;
+    pool.reserve(threads);
+    for (size_t t = 0; t < threads; ++t) pool.emplace_back(body, t);
+    for (auto& th : pool) th.join();
+}
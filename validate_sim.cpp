@@ -0,0 +1,179 @@
+// validate_sim.cpp
+// Runs the same external-sort scenarios through the simulator (K-way model)
+// and through the real engine on the shaped local object store, then compares
+// per-phase time, compute time, request counts, bytes and store cost.
+// The report is plain text with one line per (scenario, phase, metric) so
+// reports from two releases can be diffed; lines whose relative error exceeds
+// the threshold are flagged with OFF and make the exit status non-zero.
+//
+// Build: g++ -O2 -std=c++17 -pthread validate_sim.cpp external_sort.cpp local_object_store.cpp radix_sort.cpp -o validate_sim
+// Usage: ./validate_sim [report=validation_report.txt] [threshold=0.25] [compute_profile]
+
+#include "external_sort_sim.hpp"
+#include "external_sort.hpp"
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <vector>
+
+using namespace std;
+
+static const int SIM_REPEATS = 20;  // simulator runs averaged per scenario
+
+struct Scenario {
+    string name;
+    double dataset_MB;
+    double run_MB;
+    int fanin;
+};
+
+// Store shaping that matches a simulated ObjectStore
+static StoreShaping shaping_of(const ObjectStore& s) {
+    StoreShaping sh;
+    sh.latency_ms = s.latency_ms;
+    sh.mean_throughput_MBps = s.mean_throughput_MBps;
+    sh.throughput_jitter = s.throughput_jitter;
+    sh.cost_per_GB = s.cost_per_GB;
+    sh.cost_per_request = s.cost_per_request;
+    sh.chunk_size_MB = s.chunk_size_MB;
+    return sh;
+}
+
+static vector<pair<string, double>> metrics_of(const SimPhase& p) {
+    return {{"time_sec", p.time_sec}, {"compute_sec", p.compute_sec},
+            {"get_requests", double(p.get_requests)}, {"put_requests", double(p.put_requests)},
+            {"MB_read", p.MB_read}, {"MB_written", p.MB_written}, {"cost", p.cost}};
+}
+
+static SimPhase as_sim_phase(const PhaseStats& p) {
+    SimPhase s;
+    s.name = p.name;
+    s.time_sec = p.wall_sec;
+    s.compute_sec = p.compute_sec;
+    s.get_requests = p.store.get_requests;
+    s.put_requests = p.store.put_requests;
+    s.MB_read = p.store.bytes_read / 1048576.0;
+    s.MB_written = p.store.bytes_written / 1048576.0;
+    s.cost = p.store.cost;
+    return s;
+}
+
+// Mean per-phase prediction over SIM_REPEATS runs of the K-way model
+static map<string, SimPhase> predict(const Scenario& sc, const ObjectStore& store, const ComputeNode& node) {
+    map<string, SimPhase> mean;
+    KWayNoSkew algo(sc.fanin, sc.run_MB);
+    for (int r = 0; r < SIM_REPEATS; ++r) {
+        ObjectStore s = store;
+        ComputeNode n = node;
+        algo.run(sc.dataset_MB, s, n);
+        for (auto& p : algo.phases) {
+            auto& m = mean[p.name];
+            m.name = p.name;
+            m.time_sec += p.time_sec / SIM_REPEATS;
+            m.cost += p.cost / SIM_REPEATS;
+            m.compute_sec += p.compute_sec / SIM_REPEATS;
+            m.get_requests += p.get_requests;
+            m.put_requests += p.put_requests;
+            m.MB_read += p.MB_read / SIM_REPEATS;
+            m.MB_written += p.MB_written / SIM_REPEATS;
+        }
+    }
+    for (auto& kv : mean) { kv.second.get_requests /= SIM_REPEATS; kv.second.put_requests /= SIM_REPEATS; }
+    return mean;
+}
+
+static map<string, SimPhase> measure(const Scenario& sc, const ObjectStore& store, const string& dir) {
+    filesystem::remove_all(dir);
+    vector<uint64_t> keys(size_t(sc.dataset_MB * 1024 * 1024 / sizeof(uint64_t)));
+    mt19937_64 gen(7);
+    for (auto& k : keys) k = gen();
+    LocalObjectStore(dir, StoreShaping()).put("input", keys.data(), keys.size() * sizeof(uint64_t));
+
+    LocalObjectStore local(dir, shaping_of(store));
+    ExternalSortConfig cfg;
+    cfg.run_MB = sc.run_MB;
+    cfg.fanin = sc.fanin;
+    cfg.buffer_MB = store.chunk_size_MB;
+    map<string, SimPhase> out;
+    for (auto& p : ExternalSortEngine(local, cfg).sort("input", "output")) out[p.name] = as_sim_phase(p);
+    filesystem::remove_all(dir);
+    return out;
+}
+
+int main(int argc, char** argv) {
+    string report_path = argc > 1 ? argv[1] : "validation_report.txt";
+    double threshold = argc > 2 ? atof(argv[2]) : 0.25;
+
+    // Small chunks keep request counts meaningful at laptop-sized datasets
+    ObjectStore store{20, 100, 0.2, 0.023, 0.000005, 8};
+    ComputeNode node{100, 0, 0, 1};  // no stragglers and no compute billing on one local box
+    ComputeProfile profile;
+    if (argc > 3) {
+        if (!profile.load(argv[3])) { cerr << "Cannot load compute profile " << argv[3] << "\n"; return 1; }
+        node.profile = &profile;
+    }
+
+    vector<Scenario> scenarios{
+        {"two_pass_k4", 64, 8, 4},
+        {"single_merge_k8", 64, 8, 8},
+        {"partial_pass_k3", 48, 8, 3},
+    };
+
+    ostringstream rep;
+    rep << "# simulator vs local engine, threshold " << threshold * 100 << "%\n";
+    rep << "# scenario phase metric predicted measured rel_err flag\n";
+    rep << fixed;
+    int flagged = 0;
+    for (auto& sc : scenarios) {
+        cout << "Scenario " << sc.name << " (" << sc.dataset_MB << " MB, runs " << sc.run_MB
+             << " MB, k=" << sc.fanin << ")\n";
+        auto pred = predict(sc, store, node);
+        auto meas = measure(sc, store, "validate_store");
+
+        map<string, SimPhase> phases = meas;
+        for (auto& kv : pred) phases[kv.first].name = kv.first;
+        SimPhase pred_total, meas_total;
+        pred_total.name = meas_total.name = "total";
+        auto add = [](SimPhase& a, const SimPhase& b) {
+            a.time_sec += b.time_sec; a.cost += b.cost; a.compute_sec += b.compute_sec;
+            a.get_requests += b.get_requests; a.put_requests += b.put_requests;
+            a.MB_read += b.MB_read; a.MB_written += b.MB_written;
+        };
+        vector<string> names;
+        for (auto& kv : phases) {
+            names.push_back(kv.first);
+            add(pred_total, pred[kv.first]);
+            add(meas_total, meas[kv.first]);
+        }
+        pred["total"] = pred_total;
+        meas["total"] = meas_total;
+        names.push_back("total");
+
+        for (auto& ph : names) {
+            auto pm = metrics_of(pred[ph]), mm = metrics_of(meas[ph]);
+            for (size_t i = 0; i < pm.size(); ++i) {
+                double p = pm[i].second, m = mm[i].second;
+                double err = m != 0 ? (p - m) / m : (p == 0 ? 0 : INFINITY);
+                bool off = fabs(err) > threshold;
+                flagged += off;
+                rep << sc.name << " " << ph << " " << pm[i].first << " "
+                    << setprecision(pm[i].first == "cost" ? 6 : 3) << p << " " << m << " "
+                    << setprecision(1) << showpos << err * 100 << "%" << noshowpos
+                    << (off ? " OFF" : "") << "\n";
+            }
+        }
+    }
+    rep << "# flagged " << flagged << "\n";
+
+    cout << rep.str();
+    ofstream(report_path) << rep.str();
+    cout << "Report written to " << report_path << "\n";
+    return flagged ? 2 : 0;
+}